@@ -1,12 +1,100 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
+#include <dlfcn.h>
+#include <unistd.h>
 #include <iostream>
+#include <string>
 #include <vector>
 #include <set>
 
+struct zstd_in_buffer {
+    const void* src;
+    size_t size;
+    size_t pos;
+};
+
+struct zstd_out_buffer {
+    void* dst;
+    size_t size;
+    size_t pos;
+};
+
+// Writes the edge list to stdout, as text or gzip or zstd compressed.
+// libz and libzstd are loaded at run time, so neither is needed to build.
+struct output_sink {
+    enum format {plain, gzip, zstd};
+
+    format kind = plain;
+    void* gz = nullptr;
+    void* cctx = nullptr;
+    int (*gzwrite)(void*, const void*, unsigned) = nullptr;
+    int (*gzclose)(void*) = nullptr;
+    size_t (*ZSTD_compressStream2)(void*, zstd_out_buffer*, zstd_in_buffer*, int) = nullptr;
+    unsigned (*ZSTD_isError)(size_t) = nullptr;
+    size_t (*ZSTD_freeCCtx)(void*) = nullptr;
+
+    bool open(format kind_) {
+        kind = kind_;
+        if (kind == gzip) {
+            void* lib = dlopen("libz.so.1", RTLD_NOW | RTLD_LOCAL);
+            if (!lib) return false;
+            void* (*gzdopen)(int, const char*) = reinterpret_cast<void* (*)(int, const char*)>(dlsym(lib, "gzdopen"));
+            gzwrite = reinterpret_cast<int (*)(void*, const void*, unsigned)>(dlsym(lib, "gzwrite"));
+            gzclose = reinterpret_cast<int (*)(void*)>(dlsym(lib, "gzclose"));
+            if (!gzdopen || !gzwrite || !gzclose) return false;
+            fflush(stdout);
+            gz = gzdopen(dup(fileno(stdout)), "wb6");
+            return gz != nullptr;
+        }
+        if (kind == zstd) {
+            void* lib = dlopen("libzstd.so.1", RTLD_NOW | RTLD_LOCAL);
+            if (!lib) return false;
+            void* (*ZSTD_createCCtx)() = reinterpret_cast<void* (*)()>(dlsym(lib, "ZSTD_createCCtx"));
+            ZSTD_compressStream2 = reinterpret_cast<size_t (*)(void*, zstd_out_buffer*, zstd_in_buffer*, int)>(dlsym(lib, "ZSTD_compressStream2"));
+            ZSTD_isError = reinterpret_cast<unsigned (*)(size_t)>(dlsym(lib, "ZSTD_isError"));
+            ZSTD_freeCCtx = reinterpret_cast<size_t (*)(void*)>(dlsym(lib, "ZSTD_freeCCtx"));
+            if (!ZSTD_createCCtx || !ZSTD_compressStream2 || !ZSTD_isError || !ZSTD_freeCCtx) return false;
+            cctx = ZSTD_createCCtx();
+            return cctx != nullptr;
+        }
+        return true;
+    }
+
+    // Feeds [p, p + len) to the zstd stream; end (2) also finishes the frame.
+    bool zstd_feed(const char* p, size_t len, int end) {
+        static char out[1 << 16];
+        zstd_in_buffer in = {p, len, 0};
+        while (true) {
+            zstd_out_buffer to = {out, sizeof(out), 0};
+            size_t left = ZSTD_compressStream2(cctx, &to, &in, end);
+            if (ZSTD_isError(left)) return false;
+            if (fwrite(out, 1, to.pos, stdout) != to.pos) return false;
+            if (end ? left == 0 : in.pos == in.size) return true;
+        }
+    }
+
+    bool write(const char* p, size_t len) {
+        if (kind == gzip) return len == 0 || gzwrite(gz, p, (unsigned)len) == (int)len;
+        if (kind == zstd) return zstd_feed(p, len, 0);
+        return fwrite(p, 1, len, stdout) == len;
+    }
+
+    bool close() {
+        if (kind == gzip) return gzclose(gz) == 0;
+        if (kind == zstd) {
+            bool ok = zstd_feed(nullptr, 0, 2);
+            ZSTD_freeCCtx(cctx);
+            return ok && fflush(stdout) == 0;
+        }
+        return fflush(stdout) == 0;
+    }
+};
+
 void print_usage(const char* program_name) {
-    printf("Usage: %s nC lC nK lK three_edges [seed]\n", program_name);
+    printf("Usage: %s [--gzip | --zstd] nC lC nK lK three_edges [seed]\n", program_name);
+    printf("  --gzip, --zstd: write the edge list compressed\n");
     printf("  nC: number of cycle subgraphs\n");
     printf("  lC: length of cycles (must be at least 3)\n");
     printf("  nK: number of complete subgraphs\n");
@@ -16,6 +104,19 @@ void print_usage(const char* program_name) {
 }
 
 int main(int argc, char* argv[]) {
+    output_sink::format format = output_sink::plain;
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--gzip") == 0) {
+            format = output_sink::gzip;
+        } else if (strcmp(argv[i], "--zstd") == 0) {
+            format = output_sink::zstd;
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+
     if (argc < 6 || argc > 7) {
         print_usage(argv[0]);
         return 1;
@@ -151,9 +252,27 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    std::cout << n << " " << unique_edges.size() << "\n";
-    for (const auto& edge : unique_edges) {
-        std::cout << edge.first << " " << edge.second << "\n";
+    output_sink out;
+    if (!out.open(format)) {
+        fprintf(stderr, "Error: could not load %s to compress the output\n", format == output_sink::gzip ? "libz.so.1" : "libzstd.so.1");
+        return 1;
+    }
+
+    std::string text = std::to_string(n) + " " + std::to_string(unique_edges.size()) + "\n";
+    bool written = true;
+    for (long i = 0; written && i < (long)unique_edges.size(); i++) {
+        text += std::to_string(unique_edges[i].first);
+        text += ' ';
+        text += std::to_string(unique_edges[i].second);
+        text += '\n';
+        if (text.size() >= (1 << 20)) {
+            written = out.write(text.data(), text.size());
+            text.clear();
+        }
+    }
+    if (!written || !out.write(text.data(), text.size()) || !out.close()) {
+        fprintf(stderr, "Error: could not write the edge list\n");
+        return 1;
     }
 
     return 0;
@@ -1,10 +1,53 @@
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <charconv>
+#include <iterator>
+#include <iomanip>
+#include <string>
 #include <vector>
 #include <stack>
 #include <memory>
 #include <algorithm>
+#include <functional>
+#include <optional>
+#include <variant>
+#include <array>
+#include <limits>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <exception>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <cstdlib>
+#include <cmath>
+#include <chrono>
+#include <random>
+#include <numeric>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <dlfcn.h>
+#include <sys/uio.h>
+#include <malloc.h>
+#if defined(__x86_64__)
+#include <x86intrin.h>
+#endif
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#define __IO_URING__
+#endif
 
 // ==================== LOGGING ====================
 #ifdef __VERBOSE_LOGGING__
@@ -27,1506 +70,7190 @@
 #define L_LOG(a)
 #endif
 
-// ==================== GRAPH ====================
-using edge_t = std::pair<int, int>;
+// ==================== TRACING ====================
+// events recorded at run time (--trace), so a slow run can be looked into
+// without a logging build: each thread writes fixed-size binary events into
+// a ring buffer of its own, which keeps the latest ones, and the rings are
+// written out when the run ends. --trace-json turns that file into the
+// Chrome trace format, which Perfetto opens too. level 1 records phases,
+// bicomps and certificates, level 2 also every step of the ear decomposition
+// (stack pushes and pops, ear updates, K23 tests, compositions). with
+// tracing off an event site costs a load and a branch
+enum class trace_kind : uint8_t {
+    span_begin, // a: the span, b: its argument
+    span_end, // a: the span
+    bicomp, // a: its root, b: the first vertex below it
+    certificate, // a: the verdict, b: the certificate's index in the variant
+    stack_push, // a: the ear end the entry waits for, b: the entry
+    stack_pop, // a: the ear end, b: the entry
+    ear, // a: the vertex, b and c: its new ear
+    k23_test, // a: the vertex, b: its parent
+    compose, // a and b: the terminals made, c: the c_type
+};
 
-struct graph {
-    int n; // graph order
-    int e; // graph size
-    std::vector<std::vector<int>> adjLists; // graph adjacency lists
+static const char * const trace_kind_names[] = {"begin", "end", "bicomp", "certificate", "stack_push", "stack_pop", "ear", "k23_test", "compose"};
+static const char * const trace_arg_names[][3] = {
+    {"span", "arg", ""}, {"span", "", ""}, {"root", "first", ""}, {"verdict", "type", ""},
+    {"end", "entry", ""}, {"end", "entry", ""}, {"vertex", "ear_from", "ear_to"}, {"vertex", "parent", ""},
+    {"source", "sink", "type"},
+};
 
-    bool adjacent(int e1, int e2) const {
-        for (int v : adjLists[e1]) {
-            if (v == e2) return true;
-        }
-        return false;
-    }
+enum class trace_span {load, recognize, prefilter, single_pass, chain_pass, bicomps_parallel, components, component, authenticate};
+static const char * const trace_span_names[] = {"load", "recognize", "prefilter", "single_pass", "chain_pass", "bicomps_parallel", "components", "component", "authenticate"};
+
+inline int trace_level = 0; // 0 while tracing is off
+
+inline uint64_t trace_clock() {
+    #if defined(__x86_64__)
+        return __rdtsc();
+    #else
+        return (uint64_t)(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    #endif
+}
+
+// 32 bytes: ticks since the trace began, the kind in the top byte
+struct trace_event {
+    uint64_t time;
+    int64_t a, b, c;
+};
+
+struct trace_ring {
+    std::vector<trace_event> events; // a power of two of them
+    uint64_t recorded = 0; // the latest events.size() are kept
+    uint64_t thread = 0;
+};
+
+struct trace_rings {
+    std::mutex lock;
+    std::vector<std::unique_ptr<trace_ring>> rings; // outlive their threads
+    size_t capacity = (size_t)(1) << 20;
+    uint64_t origin = 0; // trace_clock() at the start
+    std::chrono::steady_clock::time_point origin_time;
+};
+
+inline trace_rings& all_trace_rings() {
+    static trace_rings rings;
+    return rings;
+}
+
+inline void trace_start(int level, size_t buffer_bytes) {
+    trace_rings& all = all_trace_rings();
+    size_t capacity = 1;
+    while (capacity * 2 * sizeof(trace_event) <= buffer_bytes) capacity *= 2;
+    all.capacity = capacity;
+    all.origin_time = std::chrono::steady_clock::now();
+    all.origin = trace_clock();
+    trace_level = level;
+}
 
-    void add_edge(int e1, int e2) {
-        adjLists[e1].push_back(e2);
-        adjLists[e2].push_back(e1);
+inline trace_ring& local_trace_ring() {
+    thread_local trace_ring * ring = nullptr;
+    if (!ring) {
+        trace_rings& all = all_trace_rings();
+        std::lock_guard<std::mutex> guard(all.lock);
+        all.rings.push_back(std::make_unique<trace_ring>());
+        ring = all.rings.back().get();
+        ring->events.resize(all.capacity);
+        ring->thread = all.rings.size() - 1;
     }
+    return *ring;
+}
+
+inline void trace(int level, trace_kind kind, int64_t a = 0, int64_t b = 0, int64_t c = 0) {
+    if (trace_level < level) return;
+    trace_ring& ring = local_trace_ring();
+    trace_event& e = ring.events[ring.recorded++ & (ring.events.size() - 1)];
+    e.time = ((trace_clock() - all_trace_rings().origin) & (((uint64_t)(1) << 56) - 1)) | ((uint64_t)(kind) << 56);
+    e.a = a;
+    e.b = b;
+    e.c = c;
+}
+
+// a phase, traced at level 1 from construction to destruction
+struct trace_scope {
+    trace_span span;
+    trace_scope(trace_span span_, int64_t arg = 0) : span{span_} {trace(1, trace_kind::span_begin, (int64_t)(span), arg);}
+    ~trace_scope() {trace(1, trace_kind::span_end, (int64_t)(span));}
+    trace_scope(trace_scope const& other) = delete;
+    trace_scope& operator=(trace_scope const& other) = delete;
+};
+
+// the trace file: a header, then per ring a header and its events, oldest first
+struct trace_file_header {
+    char magic[8];
+    double ns_per_tick;
+    uint64_t rings;
+};
 
-    void reserve(graph const& other) {
-        for (int i = 0; i < other.n; i++) {
-            adjLists.emplace_back();
-            adjLists[i].reserve(other.adjLists[i].size());
+struct trace_ring_header {
+    uint64_t thread;
+    uint64_t events;
+    uint64_t dropped; // overwritten before the end
+};
+
+static const char trace_magic[8] = {'S', 'P', 'T', 'R', 'A', 'C', 'E', '1'};
+
+// called once every traced thread is done
+inline bool trace_save(const char * path) {
+    trace_rings& all = all_trace_rings();
+    uint64_t ticks = trace_clock() - all.origin;
+    double ns = (double)(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - all.origin_time).count());
+    std::ofstream os(path, std::ios::binary);
+    trace_file_header header{};
+    std::memcpy(header.magic, trace_magic, sizeof(header.magic));
+    header.ns_per_tick = (ticks ? ns / (double)(ticks) : 1.0);
+    header.rings = all.rings.size();
+    os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (std::unique_ptr<trace_ring> const& ring : all.rings) {
+        uint64_t size = ring->events.size();
+        uint64_t kept = std::min(ring->recorded, size);
+        trace_ring_header rh{ring->thread, kept, ring->recorded - kept};
+        os.write(reinterpret_cast<const char*>(&rh), sizeof(rh));
+        for (uint64_t i = ring->recorded - kept; i < ring->recorded; i++) {
+            os.write(reinterpret_cast<const char*>(&ring->events[i & (size - 1)]), sizeof(trace_event));
         }
     }
+    return (bool)(os);
+}
 
-    void output_adj_list(int v, std::ostream& os) const {
-        os << "vertex " << v << " adjacencies: ";
-        for (int v2 : adjLists[v]) {
-            os << v2 << " ";
-        }
-        os << "\n";
+struct trace_writer {
+    const char * path;
+    ~trace_writer() {
+        if (path && !trace_save(path)) std::cerr << "Error: could not write trace " << path << "\n";
     }
 };
 
-std::istream& operator>>(std::istream& is, graph& g) {
-    g = graph{};
-    is >> g.n >> g.e;
-    g.adjLists.reserve(g.n);
-
-    for (int i = 0; i < g.n; i++) {
-        g.adjLists.emplace_back();
+// a trace file as Chrome trace JSON: spans as begin and end events, the rest
+// as instant events on the thread's track. an end whose begin was
+// overwritten is left out
+inline bool trace_to_json(const char * in_path, const char * out_path) {
+    std::ifstream is(in_path, std::ios::binary);
+    trace_file_header header{};
+    if (!is.read(reinterpret_cast<char*>(&header), sizeof(header)) || std::memcmp(header.magic, trace_magic, sizeof(trace_magic)) != 0) {
+        std::cerr << "Error: " << in_path << " is not a trace file\n";
+        return false;
+    }
+    std::ofstream os(out_path);
+    if (!os) {
+        std::cerr << "Error: could not open file " << out_path << "\n";
+        return false;
     }
 
-    for (int i = 0; i < g.e; i++) {
-        int endpoint1, endpoint2;
-        is >> endpoint1 >> endpoint2;
-        g.add_edge(endpoint1, endpoint2);
+    static const size_t n_kinds = sizeof(trace_kind_names) / sizeof(trace_kind_names[0]);
+    static const size_t n_spans = sizeof(trace_span_names) / sizeof(trace_span_names[0]);
+    os << std::fixed << std::setprecision(3);
+    os << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+    auto begin_event = [&](char const * name, char phase, uint64_t tid, double us) {
+        os << (first ? "" : ",\n") << "{\"name\":\"" << name << "\",\"ph\":\"" << phase << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":" << us;
+        first = false;
+    };
+
+    for (uint64_t r = 0; r < header.rings; r++) {
+        trace_ring_header rh{};
+        if (!is.read(reinterpret_cast<char*>(&rh), sizeof(rh))) {
+            std::cerr << "Error: " << in_path << " is cut short\n";
+            return false;
+        }
+        begin_event("thread_name", 'M', rh.thread, 0);
+        os << ",\"args\":{\"name\":\"thread " << rh.thread << (rh.dropped ? ", " + std::to_string(rh.dropped) + " events overwritten" : std::string()) << "\"}}";
+
+        std::vector<int64_t> open; // spans begun and not yet ended
+        trace_event e;
+        for (uint64_t i = 0; i < rh.events; i++) {
+            if (!is.read(reinterpret_cast<char*>(&e), sizeof(e))) {
+                std::cerr << "Error: " << in_path << " is cut short\n";
+                return false;
+            }
+            size_t kind = (size_t)(e.time >> 56);
+            double us = (double)(e.time & (((uint64_t)(1) << 56) - 1)) * header.ns_per_tick / 1000.0;
+            if (kind >= n_kinds) continue;
+
+            if (kind == (size_t)(trace_kind::span_begin) || kind == (size_t)(trace_kind::span_end)) {
+                if (e.a < 0 || (size_t)(e.a) >= n_spans) continue;
+                if (kind == (size_t)(trace_kind::span_begin)) {
+                    open.push_back(e.a);
+                    begin_event(trace_span_names[e.a], 'B', rh.thread, us);
+                    os << ",\"args\":{\"arg\":" << e.b << "}}";
+                } else if (!open.empty() && open.back() == e.a) {
+                    open.pop_back();
+                    begin_event(trace_span_names[e.a], 'E', rh.thread, us);
+                    os << "}";
+                }
+                continue;
+            }
+
+            begin_event(trace_kind_names[kind], 'i', rh.thread, us);
+            os << ",\"s\":\"t\",\"args\":{";
+            int64_t args[3] = {e.a, e.b, e.c};
+            bool first_arg = true;
+            for (int k = 0; k < 3; k++) {
+                if (!*trace_arg_names[kind][k]) continue;
+                os << (first_arg ? "" : ",") << "\"" << trace_arg_names[kind][k] << "\":" << args[k];
+                first_arg = false;
+            }
+            os << "}}";
+        }
     }
+    os << "\n]}\n";
+    return (bool)(os);
+}
 
-    for (std::vector<int>& list : g.adjLists) {
-    list.shrink_to_fit();
+// ==================== GRAPH ====================
+template <typename idx_t>
+using edge_t = std::pair<idx_t, idx_t>;
+
+// little-endian base-128 varints, for packed adjacency lists
+inline uint64_t read_varint(uint8_t const *& p) {
+    uint64_t x = 0;
+    int shift = 0;
+    uint8_t b;
+    do {
+        b = *p++;
+        x |= (uint64_t)(b & 0x7f) << shift;
+        shift += 7;
+    } while (b & 0x80);
+    return x;
 }
 
-    return is;
+inline uint8_t * write_varint(uint8_t * p, uint64_t x) {
+    for (; x >= 0x80; x >>= 7) *p++ = (uint8_t)(x | 0x80);
+    *p++ = (uint8_t)(x);
+    return p;
 }
 
-std::ostream& operator<<(std::ostream& os, graph const& g) {
-    os << "Graph with " << g.n << " vertices and " << g.e << " edges:\n";
-    for (int i = 0; i < g.n; i++) {
-        g.output_adj_list(i, os);
-    }
-    return os;
+// moves p past k varints
+inline void skip_varints(uint8_t const *& p, uint64_t k) {
+    for (; k; p++) k -= !(*p & 0x80);
 }
 
-// ==================== SP TREE ====================
-enum class c_type {
-    edge, series, parallel, antiparallel, dangling
-};
+inline size_t varint_size(uint64_t x) {
+    size_t len = 1;
+    for (; x >= 0x80; x >>= 7) len++;
+    return len;
+}
 
-char c_type_char(c_type comp) {
-    switch (comp) {
-        case c_type::edge:
-            return 'e';
-        case c_type::series:
-            return 'S';
-        case c_type::parallel:
-            return 'P';
-        case c_type::antiparallel:
-            return 'Q';
-        case c_type::dangling:
-            return 'D';
-    }
+inline uint64_t zigzag(int64_t d) {
+    return ((uint64_t)(d) << 1) ^ (uint64_t)(d >> 63);
 }
 
-struct sp_tree_node {
-    int source;
-    int sink;
-    sp_tree_node * l;
-    sp_tree_node * r;
-    c_type comp;
+inline int64_t unzigzag(uint64_t x) {
+    return (int64_t)(x >> 1) ^ -(int64_t)(x & 1);
+}
 
-    sp_tree_node(int source_, int sink_) : source{source_}, sink{sink_}, comp{c_type::edge} {}
+// walks one adjacency list in order, decoding it as it goes if it is packed;
+// dfs stacks keep one per vertex in place of an index into the list
+template <typename idx_t>
+struct neighbor_cursor {
+    using iterator_category = std::input_iterator_tag;
+    using value_type = idx_t;
+    using difference_type = std::ptrdiff_t;
+    using pointer = idx_t const *;
+    using reference = idx_t;
+
+    idx_t const * raw = nullptr; // at the current entry, if the list is raw
+    uint8_t const * packed = nullptr; // past the current entry, if packed
+    idx_t left = 0; // entries from the current one on
+    idx_t value = 0; // current neighbour
+    idx_t slot = 0; // index of the current entry in the list
+
+    bool done() const {return left == 0;}
+    idx_t operator*() const {return value;}
+
+    neighbor_cursor& operator++() {
+        slot++;
+        if (--left == 0) return *this;
+        if (raw) value = *++raw;
+        else value += (idx_t)(read_varint(packed));
+        return *this;
+    }
 
-    sp_tree_node(sp_tree_node * l_, sp_tree_node * r_, c_type comp_) : l{l_}, r{r_}, comp{comp_} {
-        switch (comp) {
-            case c_type::series:
-                source = l->source;
-                sink = r->sink;
-                break;
-            case c_type::dangling:
-            case c_type::parallel:
-            case c_type::antiparallel:
-                source = l->source;
-                sink = l->sink;
-                break;
-            case c_type::edge:
-                break;
-        }
+    bool operator==(neighbor_cursor const& other) const {return left == other.left;}
+    bool operator!=(neighbor_cursor const& other) const {return left != other.left;}
+};
+
+// the neighbours of one vertex
+template <typename idx_t>
+struct adjacency {
+    neighbor_cursor<idx_t> first;
+
+    neighbor_cursor<idx_t> begin() const {return first;}
+    neighbor_cursor<idx_t> end() const {return neighbor_cursor<idx_t>{};}
+    size_t size() const {return (size_t)(first.left);}
+
+    // O(i) on packed lists
+    idx_t operator[](size_t i) const {
+        if (first.raw) return first.raw[i];
+        neighbor_cursor<idx_t> c = first;
+        for (; i; i--) ++c;
+        return *c;
     }
 };
 
-struct sp_tree {
-    sp_tree_node * root;
+// adjacency lists kept in a file mapped from disk rather than in memory,
+// laid out as adjTargets followed by adjWeights
+template <typename idx_t>
+struct external_lists {
+    void * base = nullptr;
+    size_t bytes = 0;
+    idx_t * targets = nullptr;
+    double * weights = nullptr; // null if unweighted
+
+    external_lists() = default;
+    external_lists(external_lists const& other) = delete;
+    external_lists& operator=(external_lists const& other) = delete;
+
+    ~external_lists() {
+        if (base) munmap(base, bytes);
+    }
+};
 
-    void compose(sp_tree&& other, c_type comp) {
-        if (!root) {
-            root = other.root;
-            other.root = nullptr;
-            return;
-        } else if (!other.root) {
-            return;
-        }
-        root = new sp_tree_node{root, other.root, comp};
-        other.root = nullptr;
+template <typename idx_t>
+struct graph {
+    idx_t n; // graph order
+    idx_t e; // graph size
+    std::vector<idx_t> adjStart; // neighbours of v are adjTargets[adjStart[v] .. adjStart[v + 1])
+    std::vector<idx_t> adjTargets; // all adjacency lists, back to back
+    std::vector<double> adjWeights; // edge weights parallel to adjTargets, empty if unweighted
+    std::shared_ptr<external_lists<idx_t>> external; // if set, holds the lists in place of adjTargets and adjWeights
+
+    // packed lists, if packedBase is non-empty, in place of adjTargets: per
+    // vertex its degree, then its sorted neighbours as varint gaps, the first
+    // one zigzagged relative to the vertex itself. only every block of
+    // vertices has its offset stored, and a list is found by skipping over
+    // the ones before it in its block. adjStart is only kept for the weights
+    static const int packed_block = 3; // log2 of vertices per packedBase entry
+    std::vector<uint8_t> packed;
+    std::vector<uint64_t> packedBase; // offset in packed of every block of vertices
+
+    idx_t const * targets() const {
+        return (external ? external->targets : adjTargets.data());
     }
 
-    void l_compose(sp_tree&& other, c_type comp) {
-        if (!root) {
-            root = other.root;
-            other.root = nullptr;
-            return;
-        } else if (!other.root) {
-            return;
-        }
-        root = new sp_tree_node{other.root, root, comp};
-        other.root = nullptr;
+    double const * weights() const {
+        return (external ? external->weights : (adjWeights.empty() ? nullptr : adjWeights.data()));
     }
 
-    void deantiparallelize() {
-        std::stack<std::pair<sp_tree_node *, int>> hist;
-        bool swap = false;
-        if (!root) return;
-        hist.emplace(root, 0);
-
-        while (!hist.empty()) {
-            sp_tree_node * curr = hist.top().first;
-            if (hist.top().second == 0) {
-                hist.top().second++;
-                if (curr->r) hist.emplace(curr->r, 0);
-                if (curr->comp == c_type::antiparallel) swap = !swap;
-            } else {
-                hist.pop();
-                if (curr->l) hist.emplace(curr->l, 0);
-                if (curr->comp == c_type::antiparallel) {
-                    swap = !swap;
-                    curr->comp = c_type::parallel;
-                }
-                if (swap) {
-                    sp_tree_node * temp = curr->l;
-                    curr->l = curr->r;
-                    curr->r = temp;
-                    int temp_src = curr->source;
-                    curr->source = curr->sink;
-                    curr->sink = temp_src;
-                }
-            }
+    adjacency<idx_t> adj(idx_t v) const {
+        neighbor_cursor<idx_t> c;
+        if (packedBase.empty()) {
+            c.raw = targets() + adjStart[v];
+            c.left = adjStart[v + 1] - adjStart[v];
+            if (c.left) c.value = *c.raw;
+        } else {
+            c.packed = packed.data() + packedBase[v >> packed_block];
+            for (idx_t u = v & ~(idx_t)((1 << packed_block) - 1); u < v; u++) skip_varints(c.packed, read_varint(c.packed));
+            c.left = (idx_t)(read_varint(c.packed));
+            if (c.left) c.value = (idx_t)(v + unzigzag(read_varint(c.packed)));
         }
+        return adjacency<idx_t>{c};
     }
 
-    int source() {return root->source;}
-    int sink() {return root->sink;}
-    int underlying_tree_path_source() {
-        sp_tree_node * leftmost = root;
-        for (; leftmost->comp != c_type::edge; leftmost = leftmost->l);
-        return leftmost->sink;
+    // bytes held by the adjacency structure
+    size_t adjacency_bytes() const {
+        size_t lists = (external ? external->bytes : adjTargets.size() * sizeof(idx_t) + adjWeights.size() * sizeof(double));
+        return lists + adjStart.size() * sizeof(idx_t) + packed.size() + packedBase.size() * sizeof(uint64_t);
     }
 
-    sp_tree() {
-        root = nullptr;
+    // replaces the adjacency lists, raw or external, by packed ones held in
+    // memory. lists come out sorted, which can change the dfs order and so the
+    // certificates found, but not the verdicts
+    void pack() {
+        if (!packedBase.empty() || n <= 0) return;
+        bool weighted = (weights() != nullptr);
+        std::vector<std::pair<idx_t, idx_t>> list; // neighbour, slot
+        auto sorted = [&](idx_t v) {
+            list.clear();
+            for (neighbor_cursor<idx_t> c = adj(v).begin(); !c.done(); ++c) list.emplace_back(*c, c.slot);
+            std::sort(list.begin(), list.end());
+        };
+
+        std::vector<uint64_t> base((size_t)(((int64_t)(n) >> packed_block) + 1), 0);
+        uint64_t total = 0;
+        for (idx_t v = 0; v < n; v++) {
+            if (!(v & ((1 << packed_block) - 1))) base[v >> packed_block] = total;
+            sorted(v);
+            total += varint_size((uint64_t)(list.size()));
+            for (size_t i = 0; i < list.size(); i++) {
+                total += varint_size(i ? (uint64_t)(list[i].first - list[i - 1].first) : zigzag((int64_t)(list[i].first) - v));
+            }
+        }
+
+        std::vector<uint8_t> bytes((size_t)(total));
+        std::vector<double> sorted_weights(weighted ? (size_t)(adjStart[n]) : 0);
+        uint8_t * p = bytes.data();
+        for (idx_t v = 0; v < n; v++) {
+            sorted(v);
+            p = write_varint(p, (uint64_t)(list.size()));
+            for (size_t i = 0; i < list.size(); i++) {
+                p = write_varint(p, i ? (uint64_t)(list[i].first - list[i - 1].first) : zigzag((int64_t)(list[i].first) - v));
+                if (weighted) sorted_weights[adjStart[v] + i] = weight(v, list[i].second);
+            }
+        }
+
+        packed = std::move(bytes);
+        packedBase = std::move(base);
+        external.reset();
+        std::vector<idx_t>{}.swap(adjTargets);
+        adjWeights = std::move(sorted_weights);
+        if (!weighted) std::vector<idx_t>{}.swap(adjStart);
     }
-    sp_tree(int source_, int sink_) : root{new sp_tree_node{source_, sink_}} {}
 
-    ~sp_tree();
+    bool adjacent(idx_t e1, idx_t e2) const {
+        for (idx_t v : adj(e1)) {
+            if (v == e2) return true;
+        }
+        return false;
+    }
 
-    sp_tree(sp_tree const& other) = delete;
-    sp_tree& operator=(sp_tree const& other) = delete;
+    // index of u in adj(v), or -1
+    idx_t slot_of(idx_t v, idx_t u) const {
+        for (neighbor_cursor<idx_t> c = adj(v).begin(); !c.done(); ++c) {
+            if (*c == u) return c.slot;
+        }
+        return -1;
+    }
 
-    sp_tree(sp_tree&& other) {
-        root = other.root;
-        other.root = nullptr;
+    // weight of the edge stored at adj(v)[slot]
+    double weight(idx_t v, idx_t slot) const {
+        double const * w = weights();
+        return (!w || slot < 0) ? 1.0 : w[adjStart[v] + slot];
     }
 
-    sp_tree& operator=(sp_tree&& other) {
-        if (this != &other) {
-            delete root;
-            root = other.root;
-            other.root = nullptr;    
+    void output_adj_list(idx_t v, std::ostream& os) const {
+        os << "vertex " << v << " adjacencies: ";
+        for (idx_t v2 : adj(v)) {
+            os << v2 << " ";
         }
-        return *this;
+        os << "\n";
     }
 };
 
-std::ostream& operator<<(std::ostream& os, sp_tree_node const& t) {
-    #ifdef __VERBOSE_LOGGING__
-    os << "{";
-    if (t.l) os << *(t.l);
-    os << t.source << c_type_char(t.comp) << t.sink;
-    if (t.r) os << *(t.r);
-    os << "}";
-    #else
-    os << "{" << t.source << c_type_char(t.comp) << t.sink << "}";
-    #endif
-    return os;
-}
+// runs fn(lo, hi) over [begin, end), split into one block per thread; ranges
+// too small to pay for the threads run inline
+template <typename idx_t, typename F>
+void parallel_blocks(idx_t begin, idx_t end, int threads, F const& fn) {
+    static const idx_t grain = 1 << 14;
+    idx_t len = end - begin;
+    if (len <= 0) return;
+    if (threads <= 1 || len < grain) {
+        fn(begin, end);
+        return;
+    }
 
-std::ostream& operator<<(std::ostream& os, sp_tree const& t) {
-    if (t.root) {
-        os << *(t.root);
-    } else {
-        os << "(null tree)";
+    idx_t n_blocks = std::min<idx_t>(threads, len / (grain / 2));
+    idx_t block = (len + n_blocks - 1) / n_blocks;
+    std::vector<std::thread> pool;
+    for (idx_t lo = begin + block; lo < end; lo += block) {
+        pool.emplace_back(fn, lo, std::min(lo + block, end));
     }
-    return os;
+    fn(begin, std::min(begin + block, end));
+    for (std::thread& th : pool) th.join();
 }
 
-sp_tree::~sp_tree() {
-    if (!root) return;
-    std::stack<std::pair<sp_tree_node *, int>> hist;
-    hist.emplace(root, 0);
-    while (!hist.empty()) {
-        sp_tree_node * curr = hist.top().first;
-        if (hist.top().second == 0) {
-            hist.top().second = 1;
-            if (curr->r) hist.emplace(curr->r, 0);
-            if (curr->l) hist.emplace(curr->l, 0);
-        } else {
-            delete curr;
-            hist.pop();
-        }
+// header "n m", or "n m 1" when every edge line carries a weight: "u v w"
+struct graph_header {
+    int64_t n = 0;
+    int64_t e = 0;
+    bool weighted = false;
+
+    // 32-bit indices are enough unless some index outgrows them: vertices go
+    // up to n, adjacency positions and decomposition tree nodes to 2m
+    bool wide() const {
+        return n > std::numeric_limits<int32_t>::max() || e > std::numeric_limits<int32_t>::max() / 2;
     }
+};
+
+inline bool is_blank(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
 }
 
-struct sp_chain_stack_entry {
-    sp_tree SP;
-    int end;
-    sp_tree tail;
-    sp_chain_stack_entry(sp_tree SP_, int end_, sp_tree tail_) : SP{std::move(SP_)}, end{end_}, tail{std::move(tail_)} {}
-    sp_chain_stack_entry() = default;
-};
+// parses the header line at the start of [p, end); returns where the edge
+// lines begin, or nullptr if there is no "n m"
+const char * parse_graph_header(const char * p, const char * end, graph_header& h) {
+    h = graph_header{};
+    while (p < end && is_blank(*p)) p++;
+    std::from_chars_result r = std::from_chars(p, end, h.n);
+    if (r.ec != std::errc{}) return nullptr;
+    p = r.ptr;
+    while (p < end && is_blank(*p)) p++;
+    r = std::from_chars(p, end, h.e);
+    if (r.ec != std::errc{}) return nullptr;
+    p = r.ptr;
+
+    const char * eol = std::find(p, end, '\n');
+    int weighted = 0;
+    while (p < eol && is_blank(*p)) p++;
+    std::from_chars(p, eol, weighted);
+    h.weighted = (weighted != 0);
+    return (eol == end ? end : eol + 1);
+}
 
-// ==================== AUXILIARY FUNCTIONS ====================
-void radix_sort(std::vector<int>& v) {
-    if(v.empty()) return;
-    int max_val = *std::max_element(v.begin(), v.end());
-    std::vector<int> output(v.size());
-    std::vector<int> count(10);
-    for(int exp = 1; max_val/exp > 0; exp *= 10) {
-        std::fill(count.begin(), count.end(), 0);
-        for(int i : v) count[(i/exp)%10]++;
-        for(int i = 1; i < 10; i++) count[i] += count[i-1];
-        for(int i = (int)v.size()-1; i >= 0; i--){
-            output[count[(v[i]/exp)%10]-1] = v[i];
-            count[(v[i]/exp)%10]--;
+// parses the edges in [p, end), two or three numbers each, handing them to
+// fn(edge, weight) until it returns false; false on malformed input
+template <typename idx_t, typename F>
+bool parse_edges(const char * p, const char * end, bool weighted, F&& fn) {
+    while (true) {
+        while (p < end && is_blank(*p)) p++;
+        if (p == end) return true;
+
+        edge_t<idx_t> edge;
+        std::from_chars_result r = std::from_chars(p, end, edge.first);
+        if (r.ec != std::errc{}) return false;
+        p = r.ptr;
+        while (p < end && is_blank(*p)) p++;
+        r = std::from_chars(p, end, edge.second);
+        if (r.ec != std::errc{}) return false;
+        p = r.ptr;
+
+        double w = 1.0;
+        if (weighted) {
+            while (p < end && is_blank(*p)) p++;
+            r = std::from_chars(p, end, w);
+            if (r.ec != std::errc{}) return false;
+            p = r.ptr;
         }
-        v = output;
+        if (!fn(edge, w)) return true;
     }
 }
 
-bool trace_path(int end1, int end2, std::vector<edge_t> const& path, graph const& g, std::vector<bool>& seen) {
-    #ifdef __VERBOSE_LOGGING__
-    for (edge_t edge : path) {
-        V_LOG("(" << edge.first << ", " << edge.second << ") ")
-    }
-    #endif
-    
-    N_LOG("\n")
-    if (path.size() == 0) {
-        L_LOG("====== AUTH FAILED: no edges in path ======\n")
-        return false;
+// a fifo of at most capacity items between two pipeline stages: push waits
+// while it is full, pop while it is empty, and pop fails once it is closed
+// and drained
+template <typename T>
+struct bounded_queue {
+    size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex lock;
+    std::condition_variable not_full;
+    std::condition_variable not_empty;
+
+    explicit bounded_queue(size_t capacity_) : capacity{capacity_} {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> guard{lock};
+        not_full.wait(guard, [&]() {return items.size() < capacity;});
+        items.push_back(std::move(item));
+        not_empty.notify_one();
     }
 
-    if (path[0].first == end2) {
-        int tmp = end2;
-        end2 = end1;
-        end1 = tmp;
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> guard{lock};
+        not_empty.wait(guard, [&]() {return !items.empty() || closed;});
+        if (items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
     }
 
-    if (path[0].first != end1) {
-        L_LOG("====== AUTH FAILED: start of path does not match either endpoint ======\n")
-        return false;
+    void close() {
+        std::lock_guard<std::mutex> guard{lock};
+        closed = true;
+        not_empty.notify_all();
     }
+};
 
-    if (path.back().second != end2) {
-        L_LOG("====== AUTH FAILED: end of path does not match second endpoint ======\n")
-        return false;
-    }
+enum class compression : char {none, gzip, zstd};
 
-    seen[end1] = true;
-    int prev_v = end1;
-    for (edge_t edge : path) {
-        if (!g.adjacent(edge.first, edge.second)) {
-            L_LOG("====== AUTH FAILED: edge (" << edge.first << ", " << edge.second << ") does not exist in graph ======\n")
-            return false;
-        }
+// what the magic bytes at the start of [p, end) say the input is
+inline compression sniff_compression(const char * p, const char * end) {
+    if (end - p >= 2 && (unsigned char)(p[0]) == 0x1f && (unsigned char)(p[1]) == 0x8b) return compression::gzip;
+    if (end - p >= 4 && std::memcmp(p, "\x28\xb5\x2f\xfd", 4) == 0) return compression::zstd;
+    return compression::none;
+}
 
-                if (prev_v != edge.first) {
-            L_LOG("====== AUTH FAILED: edge (" << edge.first << ", " << edge.second << ") is not incident on the previous edge ======\n")
-            return false;
-        }
+// zlib's stream state as zlib.h lays it out; inflateInit2_ refuses a stream
+// of the wrong size
+struct zlib_stream {
+    const unsigned char * next_in;
+    unsigned avail_in;
+    unsigned long total_in;
+    unsigned char * next_out;
+    unsigned avail_out;
+    unsigned long total_out;
+    const char * msg;
+    void * state;
+    void * zalloc;
+    void * zfree;
+    void * opaque;
+    int data_type;
+    unsigned long adler;
+    unsigned long reserved;
+};
 
-        prev_v = edge.second;
+struct zstd_in_buffer {
+    const void * src;
+    size_t size;
+    size_t pos;
+};
 
-        if (seen[edge.second]) {
-            L_LOG("====== AUTH FAILED: duplicated vertex " << edge.second << " ======\n")
-            return false;
+struct zstd_out_buffer {
+    void * dst;
+    size_t size;
+    size_t pos;
+};
+
+// the entry points of libz and libzstd, looked up once at run time, so
+// neither library is needed to build; one that is not installed leaves its
+// format unreadable
+struct codec_library {
+    const char * (*zlibVersion)() = nullptr;
+    int (*inflateInit2_)(zlib_stream *, int, const char *, int) = nullptr;
+    int (*inflate)(zlib_stream *, int) = nullptr;
+    int (*inflateReset)(zlib_stream *) = nullptr;
+    int (*inflateEnd)(zlib_stream *) = nullptr;
+
+    void * (*ZSTD_createDStream)() = nullptr;
+    size_t (*ZSTD_freeDStream)(void *) = nullptr;
+    size_t (*ZSTD_decompressStream)(void *, zstd_out_buffer *, zstd_in_buffer *) = nullptr;
+    unsigned (*ZSTD_isError)(size_t) = nullptr;
+
+    bool gzip = false;
+    bool zstd = false;
+
+    template <typename T>
+    static bool bind(void * lib, const char * name, T& fn) {
+        fn = reinterpret_cast<T>(dlsym(lib, name));
+        return fn != nullptr;
+    }
+
+    codec_library() {
+        if (void * z = dlopen("libz.so.1", RTLD_NOW | RTLD_LOCAL)) {
+            gzip = bind(z, "zlibVersion", zlibVersion) && bind(z, "inflateInit2_", inflateInit2_) && bind(z, "inflate", inflate)
+                && bind(z, "inflateReset", inflateReset) && bind(z, "inflateEnd", inflateEnd);
+        }
+        if (void * zs = dlopen("libzstd.so.1", RTLD_NOW | RTLD_LOCAL)) {
+            zstd = bind(zs, "ZSTD_createDStream", ZSTD_createDStream) && bind(zs, "ZSTD_freeDStream", ZSTD_freeDStream)
+                && bind(zs, "ZSTD_decompressStream", ZSTD_decompressStream) && bind(zs, "ZSTD_isError", ZSTD_isError);
         }
+    }
 
-        seen[edge.second] = true;
+    static codec_library const& get() {
+        static codec_library lib;
+        return lib;
     }
 
-    N_LOG("path good\n")
-    seen[end1] = false;
-    seen[end2] = false;
-    return true;
-}
+    bool has(compression packing) const {
+        return (packing == compression::gzip ? gzip : zstd);
+    }
+};
 
-int num_comps_after_removal(graph const& g, int v) {
-    int retval = 0;
-    std::vector<bool> seen((size_t)(g.n), false);
+inline const char * compression_name(compression packing) {
+    return (packing == compression::gzip ? "gzip" : "zstd");
+}
 
-    for (int i = 0; i < g.n; i++) {
-        if (seen[i] || i == v) continue;
-        retval++;
+inline const char * compression_library(compression packing) {
+    return (packing == compression::gzip ? "libz.so.1" : "libzstd.so.1");
+}
 
-        std::stack<int> dfs;
-        dfs.emplace(i);
+// decompresses the gzip members in [begin, end), a block at a time, into
+// emit(block) until it returns false; false if the input is corrupt or cut
+// short before that
+template <typename F>
+bool inflate_gzip(codec_library const& lib, const char * begin, const char * end, size_t block, F const& emit) {
+    static const size_t max_in = (size_t)(1) << 30;
+    zlib_stream z;
+    std::memset(&z, 0, sizeof(z));
+    if (lib.inflateInit2_(&z, 15 + 16, lib.zlibVersion(), (int)(sizeof(z))) != 0) return false;
+
+    const unsigned char * in = reinterpret_cast<const unsigned char *>(begin);
+    const unsigned char * in_end = reinterpret_cast<const unsigned char *>(end);
+    bool ok = true;
+    bool member_open = true;
+    while (true) {
+        if (z.avail_in == 0 && in < in_end) {
+            z.next_in = in;
+            z.avail_in = (unsigned)(std::min<size_t>((size_t)(in_end - in), max_in));
+            in += z.avail_in;
+        }
 
-        while (!dfs.empty()) {
-            int w = dfs.top();
-            dfs.pop();
-            seen[w] = true;
+        std::string out(block, '\0');
+        z.next_out = reinterpret_cast<unsigned char *>(&out[0]);
+        z.avail_out = (unsigned)(block);
+        int rc = lib.inflate(&z, 0);
+        out.resize(block - z.avail_out);
+        if (!out.empty() && !emit(std::move(out))) {
+            member_open = false;
+            break;
+        }
 
-            for (int u : g.adjLists[w]) {
-                if (!seen[u] && u != v) {
-                    dfs.emplace(u);
-                }
+        if (rc == 1) {
+            // the end of a member: another may follow, and trailing bytes that
+            // do not start one are ignored, as gzip -d does
+            member_open = false;
+            if (z.avail_in == 0 && in < in_end) {
+                z.next_in = in;
+                z.avail_in = (unsigned)(std::min<size_t>((size_t)(in_end - in), max_in));
+                in += z.avail_in;
             }
+            if (z.avail_in < 2 || z.next_in[0] != 0x1f || z.next_in[1] != 0x8b) break;
+            lib.inflateReset(&z);
+            member_open = true;
+        } else if (rc != 0 && rc != -5) {
+            ok = false;
+            break;
+        } else if (rc == -5 && z.avail_in == 0 && in == in_end) {
+            break;
         }
     }
+    lib.inflateEnd(&z);
+    return ok && !member_open;
+}
 
-    return retval;
+// decompresses the zstd frames in [begin, end) like inflate_gzip
+template <typename F>
+bool inflate_zstd(codec_library const& lib, const char * begin, const char * end, size_t block, F const& emit) {
+    void * ds = lib.ZSTD_createDStream();
+    if (!ds) return false;
+
+    zstd_in_buffer in{begin, (size_t)(end - begin), 0};
+    size_t pending = 1; // zero once a frame is complete
+    bool ok = true;
+    while (true) {
+        std::string out(block, '\0');
+        zstd_out_buffer to{&out[0], block, 0};
+        pending = lib.ZSTD_decompressStream(ds, &to, &in);
+        if (lib.ZSTD_isError(pending)) {
+            ok = false;
+            break;
+        }
+        out.resize(to.pos);
+        if (!out.empty() && !emit(std::move(out))) {
+            pending = 0;
+            break;
+        }
+        if (in.pos == in.size && to.pos < to.size) break;
+    }
+    lib.ZSTD_freeDStream(ds);
+    return ok && pending == 0;
 }
 
-bool is_cut_vertex(graph const& g, int v) {
-    if (num_comps_after_removal(g, v) <= 1) {
-        L_LOG("\n====== AUTH FAILED: " << v << " not a cut vertex ======\n\n")
+// decompresses [begin, end) on a thread of its own, handing the text to
+// fn(block_begin, block_end) in blocks of up to a megabyte while the next
+// ones are decompressed, until fn returns false. false if the input is
+// corrupt or cut short, or its library is not installed
+template <typename F>
+bool inflate_text(compression packing, const char * begin, const char * end, F&& fn) {
+    static const size_t block = (size_t)(1) << 20;
+    codec_library const& lib = codec_library::get();
+    if (!lib.has(packing)) return false;
+
+    bounded_queue<std::string> blocks{4};
+    std::atomic<bool> stop{false};
+    bool ok = true;
+    std::thread worker{[&]() {
+        auto emit = [&](std::string&& text) {
+            blocks.push(std::move(text));
+            return !stop.load(std::memory_order_relaxed);
+        };
+        ok = (packing == compression::gzip ? inflate_gzip(lib, begin, end, block, emit) : inflate_zstd(lib, begin, end, block, emit));
+        blocks.close();
+    }};
+
+    std::string text;
+    while (blocks.pop(text)) {
+        if (!stop && !fn(text.data(), text.data() + text.size())) stop = true;
+    }
+    worker.join();
+    return ok;
+}
+
+// the edge lines of an input: text in memory, or gzip or zstd compressed
+// text, which every parse decompresses anew as it goes, skipping the header
+struct graph_text {
+    const char * begin = nullptr;
+    const char * end = nullptr;
+    compression packing = compression::none;
+    size_t skip = 0; // decompressed bytes up to the edge lines
+};
+
+// reads the header of the input in [data, end), compressed or not, and
+// points text at its edge lines; false, with the reason in error, if there
+// is no header or the input cannot be decompressed
+inline bool open_graph_text(const char * data, const char * end, graph_text& text, graph_header& h, std::string& error) {
+    text = graph_text{data, end, sniff_compression(data, end), 0};
+    error = "Graph must have at least one vertex";
+    if (text.packing == compression::none) {
+        const char * body = parse_graph_header(data, end, h);
+        text.begin = body;
+        return body != nullptr;
+    }
+
+    if (!codec_library::get().has(text.packing)) {
+        error = std::string{"input is "} + compression_name(text.packing) + " compressed, but " + compression_library(text.packing) + " could not be loaded";
         return false;
     }
-    N_LOG("yes\n")
+
+    std::string head;
+    size_t eol = std::string::npos;
+    bool ok = inflate_text(text.packing, data, end, [&](const char * p, const char * q) {
+        size_t from = head.size();
+        head.append(p, q);
+        eol = head.find('\n', from);
+        return eol == std::string::npos;
+    });
+    if (!ok && eol == std::string::npos) {
+        error = std::string{"corrupt "} + compression_name(text.packing) + " input";
+        return false;
+    }
+
+    const char * body = parse_graph_header(head.data(), head.data() + head.size(), h);
+    text.skip = (size_t)(body - head.data());
+    return body != nullptr;
+}
+
+// parse_edges over text; compressed text is cut into whole lines as its
+// blocks arrive
+template <typename idx_t, typename F>
+bool parse_edges(graph_text const& text, bool weighted, F&& fn) {
+    if (text.packing == compression::none) return parse_edges<idx_t>(text.begin, text.end, weighted, fn);
+
+    bool parsed = true;
+    bool stopped = false;
+    size_t skip = text.skip;
+    std::string carry; // the line cut off at the end of the last block
+    auto parse = [&](const char * p, const char * q) {
+        parsed = parse_edges<idx_t>(p, q, weighted, [&](edge_t<idx_t> edge, double w) {
+            return !(stopped = !fn(edge, w));
+        });
+        return parsed && !stopped;
+    };
+
+    bool inflated = inflate_text(text.packing, text.begin, text.end, [&](const char * p, const char * q) {
+        size_t s = std::min<size_t>(skip, (size_t)(q - p));
+        p += s;
+        skip -= s;
+        const char * first = std::find(p, q, '\n');
+        if (first == q) {
+            carry.append(p, q);
+            return true;
+        }
+        const char * last = q;
+        while (last[-1] != '\n') last--;
+
+        carry.append(p, first + 1);
+        if (!parse(carry.data(), carry.data() + carry.size())) return false;
+        if (!parse(first + 1, last)) return false;
+        carry.assign(last, q);
+        return true;
+    });
+    if (parsed && !stopped) parse(carry.data(), carry.data() + carry.size());
+    return parsed && (inflated || stopped);
+}
+
+// builds g on n vertices from an edge list, every list in the order of edges
+template <typename idx_t>
+void graph_from_edges(idx_t n, std::vector<edge_t<idx_t>> const& edges, graph<idx_t>& g) {
+    g = graph<idx_t>{};
+    g.n = n;
+    g.e = (idx_t)(edges.size());
+    g.adjStart.assign((size_t)(n) + 1, 0);
+    for (edge_t<idx_t> edge : edges) {
+        g.adjStart[edge.first + 1]++;
+        g.adjStart[edge.second + 1]++;
+    }
+    for (idx_t v = 0; v < n; v++) g.adjStart[v + 1] += g.adjStart[v];
+
+    std::vector<idx_t> cursor(g.adjStart.begin(), g.adjStart.end() - 1);
+    g.adjTargets.resize((size_t)(g.adjStart[n]));
+    for (edge_t<idx_t> edge : edges) {
+        g.adjTargets[cursor[edge.first]++] = edge.second;
+        g.adjTargets[cursor[edge.second]++] = edge.first;
+    }
+}
+
+// a self-loop or an edge listed twice, as (v, u), or (-1, -1). the
+// recognition and the prefilter's edge count take simple graphs only
+template <typename idx_t>
+edge_t<idx_t> find_non_simple(graph<idx_t> const& g) {
+    std::vector<idx_t> seen((size_t)(g.n), -1); // last v with a neighbour u
+    for (idx_t v = 0; v < g.n; v++) {
+        for (idx_t u : g.adj(v)) {
+            if (u == v || seen[u] == v) return {v, u};
+            seen[u] = v;
+        }
+    }
+    return {-1, -1};
+}
+
+// lays out the adjacency arrays of g, whose n and e are set, from edges
+// parsed in chunks: atomic degree counts and a prefix sum, then the edges
+// scattered in parallel, a thread per chunk. false if an edge is out of range
+template <typename idx_t>
+bool scatter_edges(std::vector<std::vector<edge_t<idx_t>>> const& edges, std::vector<std::vector<double>> const& weights, bool weighted, graph<idx_t>& g, int threads) {
+    int n_chunks = (int)(edges.size());
+    std::vector<std::atomic<idx_t>> cursor((size_t)(g.n) + 1);
+    std::atomic<bool> in_range{true};
+    parallel_blocks<idx_t>(0, g.n + 1, threads, [&](idx_t lo, idx_t hi) {
+        for (idx_t v = lo; v < hi; v++) cursor[v].store(0, std::memory_order_relaxed);
+    });
+
+    auto each_chunk = [&](auto const& fn) {
+        std::vector<std::thread> workers;
+        for (int k = 1; k < n_chunks; k++) workers.emplace_back(fn, k);
+        fn(0);
+        for (std::thread& th : workers) th.join();
+    };
+
+    each_chunk([&](int k) {
+        for (edge_t<idx_t> edge : edges[k]) {
+            if (edge.first < 0 || edge.first >= g.n || edge.second < 0 || edge.second >= g.n) {
+                in_range = false;
+                return;
+            }
+            cursor[edge.first].fetch_add(1, std::memory_order_relaxed);
+            cursor[edge.second].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    if (!in_range) return false;
+
+    g.adjStart.resize((size_t)(g.n) + 1);
+    idx_t sum = 0;
+    for (idx_t v = 0; v <= g.n; v++) {
+        g.adjStart[v] = sum;
+        sum += cursor[v].load(std::memory_order_relaxed);
+        cursor[v].store(g.adjStart[v], std::memory_order_relaxed);
+    }
+
+    g.adjTargets.resize((size_t)(sum));
+    if (weighted) g.adjWeights.resize((size_t)(sum));
+
+    each_chunk([&](int k) {
+        for (size_t i = 0; i < edges[k].size(); i++) {
+            edge_t<idx_t> edge = edges[k][i];
+            idx_t at1 = cursor[edge.first].fetch_add(1, std::memory_order_relaxed);
+            idx_t at2 = cursor[edge.second].fetch_add(1, std::memory_order_relaxed);
+            g.adjTargets[at1] = edge.second;
+            g.adjTargets[at2] = edge.first;
+            if (weighted) g.adjWeights[at1] = g.adjWeights[at2] = weights[k][i];
+        }
+    });
     return true;
 }
 
-// ==================== CERTIFICATE DEFINITIONS ====================
-struct certificate {
-    bool verified = false;
-    virtual bool authenticate(graph const& g) = 0;
-    virtual ~certificate() {}
+// builds g from the edge lines in [begin, end), which follow header h. the
+// text is cut into one chunk per thread at line boundaries and parsed in
+// parallel; the adjacency arrays are then laid out from atomic degree
+// counts and a prefix sum, and the edges scattered into them in parallel.
+// with one thread every list keeps the order of the input, with more the
+// order within a list depends on scheduling
+template <typename idx_t>
+bool read_graph(const char * begin, const char * end, graph_header const& h, graph<idx_t>& g, int threads = 1) {
+    g = graph<idx_t>{};
+    g.n = (idx_t)(h.n);
+    int n_chunks = std::max(1, std::min<int>(threads, (int)((end - begin) / (1 << 20)) + 1));
+
+    std::vector<const char *> cuts{begin};
+    for (int k = 1; k < n_chunks; k++) {
+        const char * p = std::max(cuts.back(), begin + (end - begin) / n_chunks * k);
+        p = std::find(p, end, '\n');
+        cuts.push_back(p == end ? end : p + 1);
+    }
+    cuts.push_back(end);
+
+    std::vector<std::vector<edge_t<idx_t>>> edges((size_t)(n_chunks));
+    std::vector<std::vector<double>> weights((size_t)(n_chunks));
+    std::vector<char> parsed((size_t)(n_chunks), 0);
+    std::vector<std::thread> pool;
+    auto parse_chunk = [&](int k) {
+        parsed[k] = parse_edges<idx_t>(cuts[k], cuts[k + 1], h.weighted, [&](edge_t<idx_t> edge, double w) {
+            edges[k].push_back(edge);
+            if (h.weighted) weights[k].push_back(w);
+            return true;
+        });
+    };
+    for (int k = 1; k < n_chunks; k++) pool.emplace_back(parse_chunk, k);
+    parse_chunk(0);
+    for (std::thread& th : pool) th.join();
+
+    // only the first m edges count, as when they were read one by one
+    int64_t total = 0;
+    for (int k = 0; k < n_chunks; k++) {
+        if (!parsed[k] && total + (int64_t)(edges[k].size()) < h.e) return false;
+        int64_t keep = std::min<int64_t>((int64_t)(edges[k].size()), std::max<int64_t>(h.e - total, 0));
+        edges[k].resize((size_t)(keep));
+        if (h.weighted) weights[k].resize((size_t)(keep));
+        total += keep;
+    }
+    if (total != h.e) return false; // fewer edge lines than the header promised
+    g.e = (idx_t)(total);
+
+    if (!scatter_edges(edges, weights, h.weighted, g, threads)) return false;
+    N_LOG("parsed " << g.e << " edges in " << n_chunks << " chunk" << (n_chunks == 1 ? "" : "s") << "\n")
+    return true;
+}
+
+// read_graph for text that may be compressed: compressed text is parsed in
+// one chunk while its next blocks are decompressed
+template <typename idx_t>
+bool read_graph(graph_text const& text, graph_header const& h, graph<idx_t>& g, int threads = 1) {
+    if (text.packing == compression::none) return read_graph(text.begin, text.end, h, g, threads);
+
+    g = graph<idx_t>{};
+    g.n = (idx_t)(h.n);
+    std::vector<std::vector<edge_t<idx_t>>> edges(1);
+    std::vector<std::vector<double>> weights(1);
+    bool parsed = parse_edges<idx_t>(text, h.weighted, [&](edge_t<idx_t> edge, double w) {
+        if ((int64_t)(edges[0].size()) == h.e) return false;
+        edges[0].push_back(edge);
+        if (h.weighted) weights[0].push_back(w);
+        return true;
+    });
+    if (!parsed || (int64_t)(edges[0].size()) != h.e) return false;
+    g.e = (idx_t)(edges[0].size());
+
+    if (!scatter_edges(edges, weights, h.weighted, g, threads)) return false;
+    N_LOG("parsed " << g.e << " " << compression_name(text.packing) << " compressed edges\n")
+    return true;
+}
+
+// what the out-of-core loader moved
+struct io_stats {
+    int passes = 0; // over the input text
+    int64_t text_bytes = 0; // read by those passes
+    int64_t list_bytes = 0; // of adjacency lists written
 };
 
-struct negative_cert_K4 : certificate {
-    int a, b, c, d;
-    std::vector<edge_t> ab, ac, ad, bc, bd, cd;
+// msyncs [p, p + len) and lets the kernel drop its pages
+inline void drop_pages(void * p, size_t len) {
+    static const uintptr_t page = (uintptr_t)(sysconf(_SC_PAGESIZE));
+    uintptr_t from = (uintptr_t)(p) & ~(page - 1);
+    uintptr_t to = (uintptr_t)(p) + len;
+    if (to <= from) return;
+    msync((void *)(from), to - from, MS_SYNC);
+    madvise((void *)(from), to - from, MADV_DONTNEED);
+}
 
-    bool authenticate(graph const& g) override {
-        if (verified) return true;
+// read_graph for graphs whose adjacency lists do not fit in memory: the lists
+// go to a scratch file at path, mapped and unlinked, so only the O(n) row
+// offsets stay in RAM. a first pass over the text counts degrees; the lists
+// are then filled a window of vertices at a time, each window at most budget
+// bytes of lists and filled by one more pass, written in order and flushed
+// out of memory before the next. the lists come out exactly as read_graph's
+// with one thread, so recognition gives the same results and certificates.
+// compressed text is decompressed again by every pass
+template <typename idx_t>
+bool read_graph_external(graph_text const& text, graph_header const& h, graph<idx_t>& g, const char * path, size_t budget, io_stats& io) {
+    g = graph<idx_t>{};
+    g.n = (idx_t)(h.n);
+
+    // one pass over the first m edges
+    int64_t count = 0;
+    auto pass = [&](auto const& fn) {
+        count = 0;
+        io.passes++;
+        io.text_bytes += text.end - text.begin;
+        return parse_edges<idx_t>(text, h.weighted, [&](edge_t<idx_t> edge, double w) {
+            if (count == h.e) return false;
+            count++;
+            return fn(edge, w);
+        });
+    };
+
+    std::vector<idx_t> cursor((size_t)(g.n) + 1, 0);
+    bool in_range = true;
+    bool parsed = pass([&](edge_t<idx_t> edge, double) {
+        if (edge.first < 0 || edge.first >= g.n || edge.second < 0 || edge.second >= g.n) return (in_range = false);
+        cursor[edge.first]++;
+        cursor[edge.second]++;
+        return true;
+    });
+    if (!parsed || !in_range || count != h.e) return false;
+    g.e = (idx_t)(count);
+
+    g.adjStart.resize((size_t)(g.n) + 1);
+    idx_t sum = 0;
+    for (idx_t v = 0; v <= g.n; v++) {
+        g.adjStart[v] = sum;
+        sum += cursor[v];
+        cursor[v] = g.adjStart[v];
+    }
 
-        L_LOG("====== AUTHENTICATE K4: terminating vertices a: " << a << ", b: " << b << ", c: " << c << ", d: " << d << " ======\n")
-        if (a == b || b == c || c == d || d == a || a == c || b == d) {
-            L_LOG("====== AUTH FAILED: terminating vertices non-distinct ======\n\n")
+    std::shared_ptr<external_lists<idx_t>> lists{new external_lists<idx_t>{}};
+    size_t entry = sizeof(idx_t) + (h.weighted ? sizeof(double) : 0);
+    lists->bytes = (size_t)(sum) * entry;
+
+    int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) return false;
+    unlink(path);
+    if (lists->bytes) {
+        void * base = MAP_FAILED;
+        if (ftruncate(fd, (off_t)(lists->bytes)) == 0) {
+            base = mmap(nullptr, lists->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        }
+        if (base == MAP_FAILED) {
+            close(fd);
             return false;
         }
-        std::vector<bool> seen((size_t)(g.n), false);
+        lists->base = base;
+        lists->targets = static_cast<idx_t *>(base);
+        if (h.weighted) lists->weights = reinterpret_cast<double *>(lists->targets + sum); // 2m entries keep it aligned
+    }
+    close(fd);
+
+    size_t window = std::max<size_t>(budget / entry, 1);
+    for (idx_t lo = 0; lo < g.n; ) {
+        idx_t hi = lo + 1;
+        while (hi < g.n && (size_t)(g.adjStart[hi + 1] - g.adjStart[lo]) <= window) hi++;
+
+        pass([&](edge_t<idx_t> edge, double w) {
+            if (edge.first >= lo && edge.first < hi) {
+                idx_t at = cursor[edge.first]++;
+                lists->targets[at] = edge.second;
+                if (h.weighted) lists->weights[at] = w;
+            }
+            if (edge.second >= lo && edge.second < hi) {
+                idx_t at = cursor[edge.second]++;
+                lists->targets[at] = edge.first;
+                if (h.weighted) lists->weights[at] = w;
+            }
+            return true;
+        });
+
+        size_t from = (size_t)(g.adjStart[lo]);
+        size_t len = (size_t)(g.adjStart[hi]) - from;
+        drop_pages(lists->targets + from, len * sizeof(idx_t));
+        if (h.weighted) drop_pages(lists->weights + from, len * sizeof(double));
+        io.list_bytes += (int64_t)(len * entry);
+        N_LOG("external lists: vertices " << lo << " to " << hi - 1 << " written\n")
+        lo = hi;
+    }
 
-        N_LOG("verify ab: ")
-        if (!trace_path(a, b, ab, g, seen)) return false;
-        N_LOG("verify ac: ")
-        if (!trace_path(a, c, ac, g, seen)) return false;
-        N_LOG("verify ad: ")
-        if (!trace_path(a, d, ad, g, seen)) return false;
-        N_LOG("verify bc: ")
-        if (!trace_path(b, c, bc, g, seen)) return false;
-        N_LOG("verify bd: ")
-        if (!trace_path(b, d, bd, g, seen)) return false;
-        N_LOG("verify cd: ")
-        if (!trace_path(c, d, cd, g, seen)) return false;
+    g.external = lists;
+    return true;
+}
 
-        L_LOG("====== AUTH SUCCESS ======\n\n")
-        verified = true;
-        return true;
+template <typename idx_t>
+std::istream& operator>>(std::istream& is, graph<idx_t>& g) {
+    std::string text{std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()};
+    graph_header h;
+    const char * body = parse_graph_header(text.data(), text.data() + text.size(), h);
+    if (!body || !read_graph(body, text.data() + text.size(), h, g)) is.setstate(std::ios::failbit);
+    return is;
+}
+
+template <typename idx_t>
+std::ostream& operator<<(std::ostream& os, graph<idx_t> const& g) {
+    os << "Graph with " << g.n << " vertices and " << g.e << " edges:\n";
+    for (idx_t i = 0; i < g.n; i++) {
+        g.output_adj_list(i, os);
     }
-};
+    return os;
+}
+
+// reads a pipe or other stream to its end into data, which gets one byte
+// to spare; false on a read error
+inline bool read_stream(int fd, std::unique_ptr<char[]>& data, size_t& size) {
+    size_t capacity = (size_t)(1) << 16;
+    std::unique_ptr<char[]> buf(new char[capacity + 1]);
+    size = 0;
+    for (;;) {
+        if (size == capacity) {
+            std::unique_ptr<char[]> bigger(new char[2 * capacity + 1]);
+            std::memcpy(bigger.get(), buf.get(), size);
+            buf = std::move(bigger);
+            capacity *= 2;
+        }
+        ssize_t got = ::read(fd, buf.get() + size, capacity - size);
+        if (got < 0 && errno == EINTR) continue;
+        if (got < 0) return false;
+        if (got == 0) break;
+        size += (size_t)(got);
+    }
+    data = std::move(buf);
+    return true;
+}
 
-struct negative_cert_K23 : certificate {
-    int a, b;
-    std::vector<edge_t> one, two, three;
+// a file mapped read-only into memory; a pipe or other stream, which has no
+// size to map, is read whole into a buffer instead
+struct mapped_file {
+    const char * data = nullptr;
+    size_t size = 0;
+    std::unique_ptr<char[]> owned; // the buffer of a stream
 
-    bool authenticate(graph const& g) override {
-        if (verified) return true;
+    mapped_file() = default;
+    mapped_file(mapped_file const& other) = delete;
+    mapped_file& operator=(mapped_file const& other) = delete;
 
-        L_LOG("====== AUTHENTICATE K23: terminating vertices a: " << a << ", b: " << b << " ======\n")
+    ~mapped_file() {
+        if (data && size && !owned) munmap(const_cast<char *>(data), size);
+    }
 
-        if (a == b) {
-            L_LOG("====== AUTH FAILED: terminating vertices non-distinct ======\n\n")
+    bool open(const char * path) {
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close(fd);
             return false;
         }
 
-        std::vector<bool> seen((size_t)(g.n), false);
+        if (!S_ISREG(st.st_mode)) {
+            bool ok = read_stream(fd, owned, size);
+            close(fd);
+            if (!ok) return false;
+            data = owned.get();
+            return true;
+        }
 
-        N_LOG("verify path one: ")
-        if (!trace_path(a, b, one, g, seen)) return false;
-        if (one.size() < 2) {
-            L_LOG("\n====== AUTH FAILED: path one has no internal vertex ======\n\n")
-            return false;
+        size = (size_t)(st.st_size);
+        if (size == 0) {
+            close(fd);
+            data = "";
+            return true;
         }
 
-        N_LOG("verify path two: ")
-        if (!trace_path(a, b, two, g, seen)) return false;
-        if (two.size() < 2) {
-            L_LOG("\n====== AUTH FAILED: path two has no internal vertex ======\n\n")
+        void * addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) {
+            size = 0;
             return false;
         }
+        madvise(addr, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(addr);
+        return true;
+    }
+};
 
-        N_LOG("verify path three: ")
-        if (!trace_path(a, b, three, g, seen)) return false;
-        if (three.size() < 2) {
-            L_LOG("\n====== AUTH FAILED: path three has no internal vertex ======\n\n")
-            return false;
+// ==================== SP TREE ====================
+enum class c_type : uint8_t {
+    edge, series, parallel, antiparallel, dangling
+};
+
+char c_type_char(c_type comp) {
+    switch (comp) {
+        case c_type::edge:
+            return 'e';
+        case c_type::series:
+            return 'S';
+        case c_type::parallel:
+            return 'P';
+        case c_type::antiparallel:
+            return 'Q';
+        case c_type::dangling:
+            return 'D';
+    }
+}
+
+template <typename idx_t>
+struct sp_tree_node {
+    idx_t source;
+    idx_t sink;
+    sp_tree_node<idx_t> * l = nullptr;
+    sp_tree_node<idx_t> * r = nullptr;
+    c_type comp;
+    uint8_t walk = 0; // during sp_tree_walk: the link pointing back at the parent, and how it was entered
+    idx_t slot = -1; // edge leaves: index of source in adj(sink), for the edge weight
+
+    sp_tree_node(idx_t source_, idx_t sink_, idx_t slot_ = -1) : source{source_}, sink{sink_}, comp{c_type::edge}, slot{slot_} {}
+
+    sp_tree_node(sp_tree_node<idx_t> * l_, sp_tree_node<idx_t> * r_, c_type comp_) : l{l_}, r{r_}, comp{comp_} {
+        switch (comp) {
+            case c_type::series:
+                source = l->source;
+                sink = r->sink;
+                break;
+            case c_type::dangling:
+            case c_type::parallel:
+            case c_type::antiparallel:
+                source = l->source;
+                sink = l->sink;
+                break;
+            case c_type::edge:
+                break;
         }
+    }
+};
 
-        L_LOG("====== AUTH SUCCESS ======\n\n")
-        verified = true;
+enum class sp_visit {
+    pre, in, post
+};
+
+// the children sp_tree_walk enters below a node, in order, each with the
+// orientation it is read in; a null child is not entered
+template <typename idx_t>
+struct sp_walk_children {
+    sp_tree_node<idx_t> * first = nullptr;
+    bool first_swap = false;
+    sp_tree_node<idx_t> * second = nullptr;
+    bool second_swap = false;
+};
+
+// walks the tree below root depth first without a stack or any allocation
+// (Deutsch-Schorr-Waite): the child link followed down is pointed back at the
+// parent and restored on the way up, the node's walk byte telling which one,
+// whether it was the second child entered and the node's orientation.
+// choose(node, swap) names the children to enter, so subtrees can be pruned,
+// taken r before l or read reversed; it must answer the same when asked again
+// on the way back up. visit(node, phase, swap) is called on entering a node,
+// before its second child and on leaving it. the node's own links are intact
+// at every call, its ancestors' are not: choose and visit may walk or print
+// below the node, but must not climb. post may free the node. a visitor
+// returning false stops the walk once the links are restored, and the walk
+// returns false
+template <typename idx_t, typename C, typename F>
+bool sp_tree_walk(sp_tree_node<idx_t> * root, bool swap, C&& choose, F&& visit) {
+    if (!root) return true;
+    sp_tree_node<idx_t> * prev = nullptr; // parent of curr, its link to curr pointing further up
+    sp_tree_node<idx_t> * curr = root;
+    sp_tree_node<idx_t> * next;
+    int done = 0; // children of curr already entered
+    bool ok = visit(curr, sp_visit::pre, swap);
+
+    while (ok) {
+        if (done < 2) {
+            sp_walk_children<idx_t> c = choose(curr, swap);
+            if (done == 0 && !c.first) done = 1;
+            next = (done == 0 ? c.first : c.second);
+            if (next) {
+                if (done == 1 && !(ok = visit(curr, sp_visit::in, swap))) break;
+                bool right = (next == curr->r);
+                (right ? curr->r : curr->l) = prev;
+                curr->walk = (uint8_t)((right ? 1 : 0) | (done == 1 ? 2 : 0) | (swap ? 4 : 0));
+                swap = (done == 0 ? c.first_swap : c.second_swap);
+                prev = curr;
+                curr = next;
+                done = 0;
+                ok = visit(curr, sp_visit::pre, swap);
+                continue;
+            }
+        }
+
+        // the parent's link is put back first, post may free curr
+        if (!prev) {
+            ok = visit(curr, sp_visit::post, swap);
+            break;
+        }
+        uint8_t walk = prev->walk;
+        if (walk & 1) {
+            next = prev->r;
+            prev->r = curr;
+        } else {
+            next = prev->l;
+            prev->l = curr;
+        }
+        done = ((walk & 2) ? 2 : 1);
+        ok = visit(curr, sp_visit::post, swap);
+        swap = ((walk & 4) != 0);
+        curr = prev;
+        prev = next;
+    }
+
+    while (prev) {
+        if (prev->walk & 1) {
+            next = prev->r;
+            prev->r = curr;
+        } else {
+            next = prev->l;
+            prev->l = curr;
+        }
+        curr = prev;
+        prev = next;
+    }
+    return ok;
+}
+
+// the whole tree, l before r, with visit(node, phase)
+template <typename idx_t, typename F>
+bool sp_tree_walk(sp_tree_node<idx_t> * root, F&& visit) {
+    return sp_tree_walk(root, false, [](sp_tree_node<idx_t> * curr, bool) {
+        return sp_walk_children<idx_t>{curr->l, false, curr->r, false};
+    }, [&](sp_tree_node<idx_t> * curr, sp_visit phase, bool) {
+        return visit(curr, phase);
+    });
+}
+
+template <typename idx_t>
+struct sp_tree_audit;
+
+template <typename idx_t>
+struct sp_tree {
+    sp_tree_node<idx_t> * root;
+
+    void compose(sp_tree<idx_t>&& other, c_type comp) {
+        if (!root) {
+            root = other.root;
+            other.root = nullptr;
+            return;
+        } else if (!other.root) {
+            return;
+        }
+        root = new sp_tree_node<idx_t>{root, other.root, comp};
+        other.root = nullptr;
+        trace(2, trace_kind::compose, (int64_t)(root->source), (int64_t)(root->sink), (int64_t)(comp));
+        if (sp_tree_audit<idx_t> * audit = sp_tree_audit<idx_t>::active) audit->join(root);
+    }
+
+    void l_compose(sp_tree<idx_t>&& other, c_type comp) {
+        if (!root) {
+            root = other.root;
+            other.root = nullptr;
+            return;
+        } else if (!other.root) {
+            return;
+        }
+        root = new sp_tree_node<idx_t>{other.root, root, comp};
+        other.root = nullptr;
+        trace(2, trace_kind::compose, (int64_t)(root->source), (int64_t)(root->sink), (int64_t)(comp));
+        if (sp_tree_audit<idx_t> * audit = sp_tree_audit<idx_t>::active) audit->join(root);
+    }
+
+    void deantiparallelize() {
+        bool swap = false;
+        sp_tree_walk(root, [&](sp_tree_node<idx_t> * curr, sp_visit phase) {
+            if (phase == sp_visit::in) {
+                if (curr->comp == c_type::antiparallel) swap = !swap;
+            } else if (phase == sp_visit::post) {
+                if (curr->comp == c_type::antiparallel) {
+                    swap = !swap;
+                    curr->comp = c_type::parallel;
+                }
+                if (swap) {
+                    sp_tree_node<idx_t> * temp = curr->l;
+                    curr->l = curr->r;
+                    curr->r = temp;
+                    idx_t temp_src = curr->source;
+                    curr->source = curr->sink;
+                    curr->sink = temp_src;
+                }
+            }
+            return true;
+        });
+    }
+
+    idx_t source() {return root->source;}
+    idx_t sink() {return root->sink;}
+    idx_t underlying_tree_path_source() {
+        sp_tree_node<idx_t> * leftmost = root;
+        for (; leftmost->comp != c_type::edge; leftmost = leftmost->l);
+        return leftmost->sink;
+    }
+
+    sp_tree() {
+        root = nullptr;
+    }
+    sp_tree(idx_t source_, idx_t sink_, idx_t slot_ = -1) : root{new sp_tree_node<idx_t>{source_, sink_, slot_}} {
+        if (sp_tree_audit<idx_t> * audit = sp_tree_audit<idx_t>::active) audit->leaf(root);
+    }
+
+    ~sp_tree() {clear();}
+    void clear();
+
+    sp_tree(sp_tree<idx_t> const& other) = delete;
+    sp_tree<idx_t>& operator=(sp_tree<idx_t> const& other) = delete;
+
+    sp_tree(sp_tree<idx_t>&& other) {
+        root = other.root;
+        other.root = nullptr;
+    }
+
+    sp_tree<idx_t>& operator=(sp_tree<idx_t>&& other) {
+        if (this != &other) {
+            clear();
+            root = other.root;
+            other.root = nullptr;    
+        }
+        return *this;
+    }
+};
+
+template <typename idx_t>
+std::ostream& operator<<(std::ostream& os, sp_tree_node<idx_t> const& t) {
+    #ifdef __VERBOSE_LOGGING__
+    sp_tree_walk(const_cast<sp_tree_node<idx_t> *>(&t), [&](sp_tree_node<idx_t> * curr, sp_visit phase) {
+        if (phase == sp_visit::pre) os << "{";
+        if (phase == sp_visit::in || (phase == sp_visit::post && !curr->r)) os << curr->source << c_type_char(curr->comp) << curr->sink;
+        if (phase == sp_visit::post) os << "}";
         return true;
+    });
+    #else
+    os << "{" << t.source << c_type_char(t.comp) << t.sink << "}";
+    #endif
+    return os;
+}
+
+template <typename idx_t>
+std::ostream& operator<<(std::ostream& os, sp_tree<idx_t> const& t) {
+    if (t.root) {
+        os << *(t.root);
+    } else {
+        os << "(null tree)";
     }
+    return os;
+}
+
+template <typename idx_t>
+void sp_tree<idx_t>::clear() {
+    if (!root) return;
+    if (sp_tree_audit<idx_t> * audit = sp_tree_audit<idx_t>::active) audit->drop(*this);
+    sp_tree_walk(root, [](sp_tree_node<idx_t> * curr, sp_visit phase) {
+        if (phase == sp_visit::post) delete curr;
+        return true;
+    });
+    root = nullptr;
+}
+
+template <typename idx_t>
+struct sp_chain_stack_entry {
+    sp_tree<idx_t> SP;
+    idx_t end;
+    sp_tree<idx_t> tail;
+    idx_t below = -1; // the entry under this one on its stack
 };
 
-struct negative_cert_T4 : certificate {
-    int c1, c2, a, b;
-    std::vector<edge_t> c1a, c1b, c2a, c2b, ab;
+// the vertex stacks of the ear decomposition, all in one pool: a vertex keeps
+// the index of its top entry, -1 when empty, and popped entries are reused
+template <typename idx_t>
+struct sp_chain_stacks {
+    std::vector<sp_chain_stack_entry<idx_t>> pool;
+    idx_t unused = -1;
 
-    bool authenticate(graph const& g) override {
-        if (verified) return true;
-        L_LOG("====== AUTHENTICATE T4: terminating vertices a: " << a << ", b: " << b << ", c1: " << c1 << ", c2: " << c2 << " ======\n")
+    sp_chain_stack_entry<idx_t>& top(idx_t head) {return pool[head];}
 
-        if (a == b || a == c1 || a == c2 || b == c1 || b == c2 || c1 == c2) {
-            L_LOG("====== AUTH FAILED: terminating vertices non-distinct ======\n\n")
-            return false;
+    void push(idx_t& head, sp_tree<idx_t>&& SP, idx_t end) {
+        idx_t at = unused;
+        if (at == -1) {
+            at = (idx_t)(pool.size());
+            pool.emplace_back();
+        } else {
+            unused = pool[at].below;
         }
+        pool[at].SP = std::move(SP);
+        pool[at].end = end;
+        pool[at].below = head;
+        head = at;
+        trace(2, trace_kind::stack_push, (int64_t)(end), (int64_t)(at));
+    }
 
-        N_LOG("verify c1 cut vertex: ")
-        if (!is_cut_vertex(g, c1)) return false;
+    void pop(idx_t& head) {
+        sp_chain_stack_entry<idx_t>& entry = pool[head];
+        idx_t at = head;
+        trace(2, trace_kind::stack_pop, (int64_t)(entry.end), (int64_t)(at));
+        head = entry.below;
+        entry.SP = sp_tree<idx_t>{};
+        entry.tail = sp_tree<idx_t>{};
+        entry.below = unused;
+        unused = at;
+    }
+
+    void clear(idx_t& head) {
+        while (head != -1) pop(head);
+    }
+};
+
+// what the ear decomposition reads of a vertex on an edge visit, in one cache
+// line for 32-bit indices. comp is the bicomp the vertex was entered in when
+// SP_RECOGNITION runs a bicomp at a time, low its low point in sp_single_pass
+template <typename idx_t>
+struct alignas(64) sp_vertex {
+    idx_t dfs_no = 0;
+    idx_t parent = 0;
+    idx_t parent_slot = -1; // index of the vertex in adj(parent)
+    idx_t comp = -1;
+    idx_t low = 0;
+    idx_t earliest_outgoing = 0;
+    idx_t stack = -1; // top of the vertex stack, in sp_chain_stacks
+    idx_t ends = 0; // with --fused: trees not yet joined that end at the vertex, -1 once closed by a series node
+    edge_t<idx_t> ear;
+    sp_tree<idx_t> seq;
+};
+
+static_assert(sizeof(sp_vertex<int32_t>) == 64, "a vertex record should fill one cache line");
+
+// the parent fields of the vertex records, read as a parent array
+template <typename idx_t>
+struct vertex_parents {
+    std::vector<sp_vertex<idx_t>> const& vert;
+    idx_t operator[](idx_t v) const {return vert[v].parent;}
+};
+
+inline uint64_t mix64(uint64_t x) {
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+// a fresh key for every audit, so that no fixed set of wrong edges can match
+inline uint64_t audit_key() {
+    static std::atomic<uint64_t> next{((uint64_t)(std::random_device{}()) << 32) ^ (uint64_t)(std::chrono::steady_clock::now().time_since_epoch().count())};
+    return mix64(next.fetch_add(0x9e3779b97f4a7c15ULL, std::memory_order_relaxed));
+}
+
+// the decomposition tree authenticated while the ear decomposition builds it
+// (--fused), in place of positive_cert_sp::authenticate's pass after it. the
+// trees made on a thread report to the audit set there: a leaf when it is
+// made, a node when it joins two trees, whose terminals are final by then.
+// each node is checked against its children as the walk after would check
+// it, and each vertex counts the trees not yet joined that end at it, in its
+// record: a series node must be the only one to reach its middle vertex,
+// which is closed to every tree and edge made later. the edges of the leaves
+// and the entries of the adjacency lists are summed as two keyed 64-bit
+// mixes, equal when the tree produces G. a tree that fails is left to the
+// pass after, which tells why
+template <typename idx_t>
+struct sp_tree_audit {
+    static inline thread_local sp_tree_audit<idx_t> * active = nullptr;
+
+    std::vector<sp_vertex<idx_t>>& vert;
+    sp_tree_audit<idx_t> * outer;
+    uint64_t key = audit_key();
+    uint64_t h1 = 0, h2 = 0;
+    int64_t pending = 0; // trees made and not yet joined into another
+    int64_t dangling = 0; // nodes
+    bool ok = true;
+
+    sp_tree_audit(std::vector<sp_vertex<idx_t>>& vert_) : vert{vert_}, outer{active} {active = this;}
+    ~sp_tree_audit() {active = outer;}
+
+    sp_tree_audit(sp_tree_audit<idx_t> const& other) = delete;
+    sp_tree_audit<idx_t>& operator=(sp_tree_audit<idx_t> const& other) = delete;
+
+    uint64_t mix_edge(idx_t u, idx_t w) const {
+        if (w < u) std::swap(u, w);
+        return mix64(((uint64_t)(u) * 0x9e3779b97f4a7c15ULL) ^ mix64((uint64_t)(w) + key));
+    }
+
+    // an edge counts twice, as the adjacency lists hold it once from each side
+    void leaf(sp_tree_node<idx_t> const * t) {
+        idx_t& a = vert[t->source].ends;
+        idx_t& b = vert[t->sink].ends;
+        if (a < 0 || b < 0) ok = false;
+        a++;
+        b++;
+        pending++;
+        uint64_t x = mix_edge(t->source, t->sink);
+        h1 += 2 * x;
+        h2 += 2 * mix64(x ^ key);
+    }
+
+    void join(sp_tree_node<idx_t> const * t) {
+        sp_tree_node<idx_t> const * l = t->l;
+        sp_tree_node<idx_t> const * r = t->r;
+        switch (t->comp) {
+            case c_type::series:
+                if (r->source != l->sink || vert[l->sink].ends != 2) ok = false;
+                vert[l->sink].ends = -1;
+                break;
+            case c_type::parallel:
+            case c_type::antiparallel:
+                if (t->comp == c_type::parallel ? (r->source != l->source || r->sink != l->sink) : (r->source != l->sink || r->sink != l->source)) ok = false;
+                vert[l->source].ends--;
+                vert[l->sink].ends--;
+                break;
+            case c_type::dangling:
+                if (r->source != l->source) ok = false;
+                dangling++;
+                vert[r->source].ends--;
+                vert[r->sink].ends--;
+                break;
+            case c_type::edge:
+                ok = false;
+                break;
+        }
+        pending--;
+    }
+
+    // a tree freed unjoined, as a bicomp's are when it is rerun: what it
+    // added is taken back
+    void drop(sp_tree<idx_t>& tree) {
+        vert[tree.source()].ends--;
+        vert[tree.sink()].ends--;
+        pending--;
+        sp_tree_walk(tree.root, [&](sp_tree_node<idx_t> * t, sp_visit phase) {
+            if (phase != sp_visit::post) return true;
+            if (t->comp == c_type::edge) {
+                uint64_t x = mix_edge(t->source, t->sink);
+                h1 -= 2 * x;
+                h2 -= 2 * mix64(x ^ key);
+            } else if (t->comp == c_type::series) {
+                vert[t->l->sink].ends = 0;
+            } else if (t->comp == c_type::dangling) {
+                dangling--;
+            }
+            return true;
+        });
+    }
+
+    // whether tree, the last one left, is a decomposition tree of g
+    bool passes(graph<idx_t> const& g, sp_tree<idx_t>& tree, bool is_sp) const {
+        if (!ok || pending != 1 || !tree.root || (is_sp && dangling > 0)) return false;
+        if (vert[tree.source()].ends != 1 || vert[tree.sink()].ends != 1) return false;
+        uint64_t s1 = 0, s2 = 0;
+        for (idx_t v = 0; v < g.n; v++) {
+            for (idx_t u : g.adj(v)) {
+                uint64_t x = mix_edge(v, u);
+                s1 += x;
+                s2 += mix64(x ^ key);
+            }
+        }
+        return s1 == h1 && s2 == h2;
+    }
+};
+
+// ==================== AUXILIARY FUNCTIONS ====================
+template <typename idx_t>
+void radix_sort(std::vector<idx_t>& v) {
+    if(v.empty()) return;
+    idx_t max_val = *std::max_element(v.begin(), v.end());
+    std::vector<idx_t> output(v.size());
+    std::vector<idx_t> count(10);
+    for(idx_t exp = 1; max_val/exp > 0; exp *= 10) {
+        std::fill(count.begin(), count.end(), 0);
+        for(idx_t i : v) count[(i/exp)%10]++;
+        for(idx_t i = 1; i < 10; i++) count[i] += count[i-1];
+        for(idx_t i = (idx_t)v.size()-1; i >= 0; i--){
+            output[count[(v[i]/exp)%10]-1] = v[i];
+            count[(v[i]/exp)%10]--;
+        }
+        v = output;
+    }
+}
+
+template <typename idx_t>
+bool trace_path(idx_t end1, idx_t end2, std::vector<edge_t<idx_t>> const& path, graph<idx_t> const& g, std::vector<bool>& seen) {
+    #ifdef __VERBOSE_LOGGING__
+    for (edge_t<idx_t> edge : path) {
+        V_LOG("(" << edge.first << ", " << edge.second << ") ")
+    }
+    #endif
+    
+    N_LOG("\n")
+    if (path.size() == 0) {
+        L_LOG("====== AUTH FAILED: no edges in path ======\n")
+        return false;
+    }
+
+    if (path[0].first == end2) {
+        idx_t tmp = end2;
+        end2 = end1;
+        end1 = tmp;
+    }
+
+    if (path[0].first != end1) {
+        L_LOG("====== AUTH FAILED: start of path does not match either endpoint ======\n")
+        return false;
+    }
+
+    if (path.back().second != end2) {
+        L_LOG("====== AUTH FAILED: end of path does not match second endpoint ======\n")
+        return false;
+    }
+
+    seen[end1] = true;
+    idx_t prev_v = end1;
+    for (edge_t<idx_t> edge : path) {
+        if (!g.adjacent(edge.first, edge.second)) {
+            L_LOG("====== AUTH FAILED: edge (" << edge.first << ", " << edge.second << ") does not exist in graph ======\n")
+            return false;
+        }
+
+                if (prev_v != edge.first) {
+            L_LOG("====== AUTH FAILED: edge (" << edge.first << ", " << edge.second << ") is not incident on the previous edge ======\n")
+            return false;
+        }
+
+        prev_v = edge.second;
+
+        if (seen[edge.second]) {
+            L_LOG("====== AUTH FAILED: duplicated vertex " << edge.second << " ======\n")
+            return false;
+        }
+
+        seen[edge.second] = true;
+    }
+
+    N_LOG("path good\n")
+    seen[end1] = false;
+    seen[end2] = false;
+    return true;
+}
+
+template <typename idx_t>
+idx_t num_comps_after_removal(graph<idx_t> const& g, idx_t v) {
+    idx_t retval = 0;
+    std::vector<bool> seen((size_t)(g.n), false);
+
+    for (idx_t i = 0; i < g.n; i++) {
+        if (seen[i] || i == v) continue;
+        retval++;
+
+        std::stack<idx_t> dfs;
+        dfs.emplace(i);
+
+        while (!dfs.empty()) {
+            idx_t w = dfs.top();
+            dfs.pop();
+            seen[w] = true;
+
+            for (idx_t u : g.adj(w)) {
+                if (!seen[u] && u != v) {
+                    dfs.emplace(u);
+                }
+            }
+        }
+    }
+
+    return retval;
+}
+
+template <typename idx_t>
+bool is_cut_vertex(graph<idx_t> const& g, idx_t v) {
+    if (num_comps_after_removal(g, v) <= 1) {
+        L_LOG("\n====== AUTH FAILED: " << v << " not a cut vertex ======\n\n")
+        return false;
+    }
+    N_LOG("yes\n")
+    return true;
+}
+
+// ==================== CERTIFICATE DEFINITIONS ====================
+struct certificate_base {
+    bool verified = false;
+};
+
+// a certificate path kept as a few pieces, each a single edge or a walk along
+// the parent array of a dfs tree: up from `from` to its ancestor `to`, or the
+// same walk taken downwards. the edges are only spelled out by expand(), which
+// authentication calls
+template <typename idx_t>
+struct cert_path {
+    enum class walk : char {edge, up, down};
+    struct piece {
+        walk kind;
+        idx_t from, to;
+    };
+    static const int max_pieces = 6;
+
+    std::array<piece, max_pieces> pieces;
+    int size = 0;
+
+    void edge(idx_t u, idx_t v) {push(piece{walk::edge, u, v});}
+    void up(idx_t u, idx_t top) {push(piece{walk::up, u, top});}
+    void down(idx_t top, idx_t u) {push(piece{walk::down, u, top});}
+
+    void push(piece p) {
+        if (p.kind != walk::edge && p.from == p.to) return;
+        assert(size < max_pieces);
+        pieces[size++] = p;
+    }
+
+    // fn(u, v) on every edge; a downward walk is visited from its lower end
+    template <typename tree_t, typename F>
+    void for_each_edge(tree_t const& parent, F const& fn) const {
+        for (int k = 0; k < size; k++) {
+            piece const& p = pieces[k];
+            if (p.kind == walk::edge) {
+                fn(p.from, p.to);
+                continue;
+            }
+            for (idx_t i = p.from; i != p.to; i = parent[i]) {
+                if (p.kind == walk::up) fn(i, parent[i]);
+                else fn(parent[i], i);
+            }
+        }
+    }
+
+    template <typename tree_t>
+    std::vector<edge_t<idx_t>> expand(tree_t const& parent) const {
+        std::vector<edge_t<idx_t>> out;
+        for (int k = 0; k < size; k++) {
+            size_t start = out.size();
+            cert_path<idx_t> one;
+            one.pieces[0] = pieces[k];
+            one.size = 1;
+            one.for_each_edge(parent, [&](idx_t u, idx_t v) {out.emplace_back(u, v);});
+            if (pieces[k].kind == walk::down) std::reverse(out.begin() + (ptrdiff_t)(start), out.end());
+        }
+        return out;
+    }
+
+    // the piece holding uv, either way round, and where: the lower end of uv
+    // within a walk. k is size if uv is not on the path
+    template <typename tree_t>
+    std::pair<int, idx_t> find(tree_t const& parent, edge_t<idx_t> uv) const {
+        for (int k = 0; k < size; k++) {
+            piece const& p = pieces[k];
+            if (p.kind == walk::edge) {
+                if ((p.from == uv.first && p.to == uv.second) || (p.from == uv.second && p.to == uv.first)) return {k, p.from};
+                continue;
+            }
+            for (idx_t i = p.from; i != p.to; i = parent[i]) {
+                if ((i == uv.first && parent[i] == uv.second) || (i == uv.second && parent[i] == uv.first)) return {k, i};
+            }
+        }
+        return {size, -1};
+    }
+
+    template <typename tree_t>
+    bool contains(tree_t const& parent, edge_t<idx_t> uv) const {
+        return find(parent, uv).first != size;
+    }
+
+    // puts with in place of the edge uv; false if uv is not on the path
+    template <typename tree_t>
+    bool splice(tree_t const& parent, edge_t<idx_t> uv, cert_path<idx_t> const& with) {
+        std::pair<int, idx_t> at = find(parent, uv);
+        if (at.first == size) return false;
+
+        cert_path<idx_t> out;
+        for (int k = 0; k < at.first; k++) out.push(pieces[k]);
+        piece p = pieces[at.first];
+        idx_t i = at.second;
+        if (p.kind == walk::up) out.up(p.from, i);
+        if (p.kind == walk::down) out.down(p.to, parent[i]);
+        for (int k = 0; k < with.size; k++) out.push(with.pieces[k]);
+        if (p.kind == walk::up) out.up(parent[i], p.to);
+        if (p.kind == walk::down) out.down(i, p.from);
+        for (int k = at.first + 1; k < size; k++) out.push(pieces[k]);
+        *this = out;
+        return true;
+    }
+};
+
+template <typename idx_t>
+struct negative_cert_K4 : certificate_base {
+    idx_t a, b, c, d;
+    std::shared_ptr<std::vector<idx_t> const> tree; // the parent array the paths walk
+    cert_path<idx_t> ab, ac, ad, bc, bd, cd;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+
+        L_LOG("====== AUTHENTICATE K4: terminating vertices a: " << a << ", b: " << b << ", c: " << c << ", d: " << d << " ======\n")
+        if (a == b || b == c || c == d || d == a || a == c || b == d) {
+            L_LOG("====== AUTH FAILED: terminating vertices non-distinct ======\n\n")
+            return false;
+        }
+        std::vector<bool> seen((size_t)(g.n), false);
+
+        N_LOG("verify ab: ")
+        if (!trace_path(a, b, ab.expand(*tree), g, seen)) return false;
+        N_LOG("verify ac: ")
+        if (!trace_path(a, c, ac.expand(*tree), g, seen)) return false;
+        N_LOG("verify ad: ")
+        if (!trace_path(a, d, ad.expand(*tree), g, seen)) return false;
+        N_LOG("verify bc: ")
+        if (!trace_path(b, c, bc.expand(*tree), g, seen)) return false;
+        N_LOG("verify bd: ")
+        if (!trace_path(b, d, bd.expand(*tree), g, seen)) return false;
+        N_LOG("verify cd: ")
+        if (!trace_path(c, d, cd.expand(*tree), g, seen)) return false;
+
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+        this->verified = true;
+        return true;
+    }
+};
+
+template <typename idx_t>
+struct negative_cert_K23 : certificate_base {
+    idx_t a, b;
+    std::shared_ptr<std::vector<idx_t> const> tree;
+    cert_path<idx_t> one, two, three;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+
+        L_LOG("====== AUTHENTICATE K23: terminating vertices a: " << a << ", b: " << b << " ======\n")
+
+        if (a == b) {
+            L_LOG("====== AUTH FAILED: terminating vertices non-distinct ======\n\n")
+            return false;
+        }
+
+        std::vector<bool> seen((size_t)(g.n), false);
+
+        N_LOG("verify path one: ")
+        std::vector<edge_t<idx_t>> path_one = one.expand(*tree);
+        if (!trace_path(a, b, path_one, g, seen)) return false;
+        if (path_one.size() < 2) {
+            L_LOG("\n====== AUTH FAILED: path one has no internal vertex ======\n\n")
+            return false;
+        }
+
+        N_LOG("verify path two: ")
+        std::vector<edge_t<idx_t>> path_two = two.expand(*tree);
+        if (!trace_path(a, b, path_two, g, seen)) return false;
+        if (path_two.size() < 2) {
+            L_LOG("\n====== AUTH FAILED: path two has no internal vertex ======\n\n")
+            return false;
+        }
+
+        N_LOG("verify path three: ")
+        std::vector<edge_t<idx_t>> path_three = three.expand(*tree);
+        if (!trace_path(a, b, path_three, g, seen)) return false;
+        if (path_three.size() < 2) {
+            L_LOG("\n====== AUTH FAILED: path three has no internal vertex ======\n\n")
+            return false;
+        }
+
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+        this->verified = true;
+        return true;
+    }
+};
+
+// made from a K4 found through a fake edge c1 c2; that bicomp's dfs is then
+// rerun, so the paths are spelled out rather than kept as walks. the K4's
+// path through the fake edge runs d1 .. c1 c2 .. d2, so the cut vertices c1
+// and c2 hang by the tails c1d1 and c2d2 off the corners d1 and d2 of a
+// theta; a tail is empty when its cut vertex is the corner
+template <typename idx_t>
+struct negative_cert_T4 : certificate_base {
+    idx_t c1, c2, d1, d2, a, b;
+    std::vector<edge_t<idx_t>> c1d1, c2d2, d1a, d1b, d2a, d2b, ab;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+        L_LOG("====== AUTHENTICATE T4: terminating vertices a: " << a << ", b: " << b << ", d1: " << d1 << ", d2: " << d2 << ", cut vertices c1: " << c1 << ", c2: " << c2 << " ======\n")
+
+        if (a == b || a == d1 || a == d2 || b == d1 || b == d2 || d1 == d2 || c1 == c2) {
+            L_LOG("====== AUTH FAILED: terminating vertices non-distinct ======\n\n")
+            return false;
+        }
+
+        N_LOG("verify c1 cut vertex: ")
+        if (!is_cut_vertex(g, c1)) return false;
         N_LOG("verify c2 cut vertex: ")
         if (!is_cut_vertex(g, c2)) return false;
 
+        // a tail's cut vertex stays marked, so that no other path crosses it
         std::vector<bool> seen((size_t)(g.n), false);
-        N_LOG("verify path c1a: ")
-        if (!trace_path(c1, a, c1a, g, seen)) return false;
-        N_LOG("verify path c2a: ")
-        if (!trace_path(c2, a, c2a, g, seen)) return false;
+        auto tail = [&](idx_t c, idx_t d, std::vector<edge_t<idx_t>> const& path) {
+            if (c == d) return path.empty();
+            if (!trace_path(c, d, path, g, seen)) return false;
+            seen[c] = true;
+            return true;
+        };
+        N_LOG("verify tail c1d1: ")
+        if (!tail(c1, d1, c1d1)) return false;
+        N_LOG("verify tail c2d2: ")
+        if (!tail(c2, d2, c2d2)) return false;
+        N_LOG("verify path d1a: ")
+        if (!trace_path(d1, a, d1a, g, seen)) return false;
+        N_LOG("verify path d2a: ")
+        if (!trace_path(d2, a, d2a, g, seen)) return false;
         N_LOG("verify path ab: ")
         if (!trace_path(a, b, ab, g, seen)) return false;
-        N_LOG("verify path c1b: ")
-        if (!trace_path(c1, b, c1b, g, seen)) return false;
-        N_LOG("verify path c2b: ")
-        if (!trace_path(c2, b, c2b, g, seen)) return false;
+        N_LOG("verify path d1b: ")
+        if (!trace_path(d1, b, d1b, g, seen)) return false;
+        N_LOG("verify path d2b: ")
+        if (!trace_path(d2, b, d2b, g, seen)) return false;
+
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+        this->verified = true;
+        return true;
+    }
+};
+
+template <typename idx_t>
+struct negative_cert_tri_comp_cut : certificate_base {
+    idx_t v;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+        L_LOG("====== AUTHENTICATE THREE-COMPONENT CUT VERTEX: " << v << " ======\n")
+
+        idx_t comps = num_comps_after_removal(g, v);
+
+        if (comps < 3) {
+            L_LOG("====== AUTH FAILED: vertex " << v << " only splits graph into " << comps << " components ======\n\n")
+            return false;
+        }
+
+        N_LOG(comps << " comps after removal\n")
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+
+        this->verified = true;
+        return true;
+    }
+};
+
+template <typename idx_t>
+struct negative_cert_tri_cut_comp : certificate_base {
+    idx_t c1, c2, c3;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+        L_LOG("====== AUTHENTICATE BICOMP WITH THREE CUT VERTICES: cut vertices " << c1 << ", " << c2 << ", " << c3 << " ======\n")
+        N_LOG("verify c1 cut vertex: ")
+        if (!is_cut_vertex(g, c1)) return false;
+        N_LOG("verify c2 cut vertex: ")
+        if (!is_cut_vertex(g, c2)) return false;
+        N_LOG("verify c3 cut vertex: ")
+        if (!is_cut_vertex(g, c3)) return false;
+
+        std::vector<idx_t> dfs_no((size_t)(g.n), 0);
+        std::vector<idx_t> parent((size_t)(g.n)); 
+        std::vector<idx_t> low((size_t)(g.n));
+        idx_t cut_verts[3] = {c1, c2, c3};
+
+        std::stack<edge_t<idx_t>> comp_edges;
+        std::stack<std::pair<idx_t, neighbor_cursor<idx_t>>> dfs;
+
+        dfs.emplace(0, g.adj(0).begin());
+        dfs_no[0] = 1;
+        low[0] = 1;
+        parent[0] = -1;
+        idx_t curr_dfs = 2;
+
+        while (!dfs.empty()) {
+            idx_t w = dfs.top().first;
+            idx_t u = *dfs.top().second;
+
+            if (dfs_no[u] == 0) {
+                dfs.emplace(u, g.adj(u).begin());
+                comp_edges.emplace(w, u);
+                parent[u] = w;
+                dfs_no[u] = curr_dfs++;
+                low[u] = dfs_no[u];
+                continue;
+            }
+
+            if (parent[u] == w) {
+                if (low[u] >= dfs_no[w]) {
+                    bool seen[3] = {false, false, false};
+                    edge_t<idx_t> e;
+                    do {
+                        e = comp_edges.top();
+                        for (int i = 0; i < 3; i++) {
+                            if (e.first == cut_verts[i] || e.second == cut_verts[i]) seen[i] = true;
+                        }
+                        comp_edges.pop();
+                    } while (e != edge_t<idx_t>{w, u});
+
+                    if (seen[0] && seen[1] && seen[2]) {
+                        N_LOG("vertices belong to one biconnected component...\n")    
+                        L_LOG("====== AUTH SUCCESS ======\n\n")
+                        this->verified = true;
+                        return true;
+                    }
+                }
+
+                if (low[u] < low[w]) low[w] = low[u];
+            } else if (dfs_no[u] < dfs_no[w] && u != parent[w]) {
+                comp_edges.emplace(w, u);
+                if (dfs_no[u] < low[w]) low[w] = dfs_no[u];
+            }
+
+            if ((++dfs.top().second).done()) {
+                dfs.pop();
+            }
+        }
+
+        L_LOG("====== AUTH FAILED: bicomp does not contain the three cut vertices ======\n\n")
+        return false;
+    }
+};
+
+// a K4-minor-free graph on n >= 2 vertices has at most 2n - 3 edges. the
+// counts can come from the header alone, before any edge is read
+template <typename idx_t>
+struct negative_cert_edge_count : certificate_base {
+    int64_t n, e;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+        L_LOG("====== AUTHENTICATE EDGE COUNT: " << e << " edges on " << n << " vertices ======\n")
+
+        if (n < 2 || e <= 2 * n - 3) {
+            L_LOG("====== AUTH FAILED: at most 2n - 3 edges ======\n\n")
+            return false;
+        }
+        if ((int64_t)(g.n) != n || (int64_t)(g.e) != e) {
+            L_LOG("====== AUTH FAILED: graph has " << g.n << " vertices and " << g.e << " edges ======\n\n")
+            return false;
+        }
+
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+        this->verified = true;
+        return true;
+    }
+};
+
+// a graph with no vertex of degree below 3 has a K4 minor
+template <typename idx_t>
+struct negative_cert_min_degree : certificate_base {
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+        L_LOG("====== AUTHENTICATE MINIMUM DEGREE 3 ======\n")
+
+        for (idx_t v = 0; v < g.n; v++) {
+            if (g.adj(v).size() < 3) {
+                L_LOG("====== AUTH FAILED: vertex " << v << " has degree " << g.adj(v).size() << " ======\n\n")
+                return false;
+            }
+        }
+
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+        this->verified = true;
+        return true;
+    }
+};
+
+// the three classes are taken to be connected, like SP graphs are
+template <typename idx_t>
+struct negative_cert_disconnected : certificate_base {
+    idx_t a, b;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+        L_LOG("====== AUTHENTICATE DISCONNECTED: vertices " << a << " and " << b << " ======\n")
+
+        if (a < 0 || b < 0 || a >= g.n || b >= g.n) {
+            L_LOG("====== AUTH FAILED: vertex out of range ======\n\n")
+            return false;
+        }
+        std::vector<bool> seen((size_t)(g.n), false);
+        std::stack<idx_t> dfs;
+        dfs.emplace(a);
+        seen[a] = true;
+        while (!dfs.empty()) {
+            idx_t w = dfs.top();
+            dfs.pop();
+            for (idx_t u : g.adj(w)) {
+                if (u == b) {
+                    L_LOG("====== AUTH FAILED: " << b << " reached from " << a << " ======\n\n")
+                    return false;
+                }
+                if (!seen[u]) {
+                    seen[u] = true;
+                    dfs.emplace(u);
+                }
+            }
+        }
+
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+        this->verified = true;
+        return true;
+    }
+};
+
+template <typename idx_t>
+struct positive_cert_sp : certificate_base {
+    sp_tree<idx_t> decomposition;
+    bool is_sp;
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+
+        std::vector<idx_t> n_src((size_t)(g.n), 0);
+        std::vector<idx_t> n_sink((size_t)(g.n), 0);
+        std::vector<bool> no_edge((size_t)(g.n), false);
+        bool swap = false;
+
+        std::vector<std::vector<idx_t>> produced((size_t)(g.n)); // adjacency lists of the graph the tree produces
+        
+        L_LOG("====== AUTHENTICATE SP DECOMPOSITION TREE ======\n")
+        if (!decomposition.root) {
+            L_LOG("====== AUTH FAILED: decomposition tree does not exist ======\n\n")
+            return false;
+        }
+
+        bool well_formed = sp_tree_walk(decomposition.root, [&](sp_tree_node<idx_t> * curr, sp_visit phase) {
+            V_LOG("traversal: " << *curr << ", phase: " << (int)(phase) << "\n")
+            if (curr->comp == c_type::antiparallel && phase != sp_visit::pre) swap = !swap;
+            if (phase == sp_visit::in) return true;
+
+            idx_t source = (swap ? curr->sink : curr->source);
+            idx_t sink = (swap ? curr->source : curr->sink);
+
+            if (!(curr->l) || !(curr->r)) {
+                if (phase == sp_visit::post) return true;
+                if (curr->l || curr->r) {
+                    L_LOG("====== AUTH FAILED: node " << *curr << " malformed (one child) ======\n\n")
+                    return false;
+                }
+
+                if (curr->comp != c_type::edge) {
+                    L_LOG("====== AUTH FAILED: node " << *curr << " malformed (leaf, but not an edge) ======\n\n")
+                    return false;
+                }
+
+                if (no_edge[source] || no_edge[sink]) {
+                                            L_LOG("====== AUTH FAILED: edge node " << *curr << " is incident on an vertex already merged into a series SP subgraph ======\n\n")
+                    return false;
+                }
+
+                produced[source].push_back(sink);
+                produced[sink].push_back(source);
+                n_src[source]++;
+                n_sink[sink]++;
+                return true;
+            }
+            if (phase == sp_visit::pre) return true;
+
+            idx_t lsource = (swap ? curr->r->sink : curr->l->source);
+            idx_t lsink = (swap ? curr->r->source : curr->l->sink);
+            idx_t rsource = (swap ? curr->l->sink : curr->r->source);
+            idx_t rsink = (swap ? curr->l->source : curr->r->sink);
+
+            switch (curr->comp) {
+                case c_type::edge:
+                    L_LOG("====== AUTH FAILED: node " << *curr << " malformed (edge, but internal) ======\n\n")
+                    return false;
+                case c_type::series:
+                    if (lsource != source || rsink != sink || lsink != rsource) {
+                        L_LOG("====== AUTH FAILED: node " << *curr << " malformed (series children source/sink mismatch) ======\n\n")
+                        return false;
+                    }
+
+                    if (n_src[lsink] != 1 || n_sink[lsink] != 1) {
+                        L_LOG("====== AUTH FAILED: series node " << *curr << " has incident edges on its middle vertex " << lsink << " which cannot be merged into it ======\n\n")
+                        return false;
+                    }
+
+                    V_LOG("BLOCKING: " << lsink << "\n")
+                    no_edge[lsink] = true;
+                    n_src[lsink]--;
+                    n_sink[lsink]--;
+                    break;
+                case c_type::parallel:
+                    if (lsource != source || rsource != source || lsink != sink || rsink != sink) {
+                        L_LOG("====== AUTH FAILED: node " << *curr << " malformed (parallel children source/sink mismatch) ======\n\n")
+                        return false;
+                    }
+
+                    n_src[source]--;
+                    n_sink[sink]--;
+                    break;
+                case c_type::antiparallel:
+                    if (swap) {
+                        if (lsource != sink || rsource != source || lsink != source || rsink != sink) {
+                            L_LOG("====== AUTH FAILED: node " << *curr << " malformed (antiparallel children source/sink mismatch) ======\n\n")
+                            return false;
+                        }
+                    } else {
+                        if (lsource != source || rsource != sink || lsink != sink || rsink != source) {
+                            L_LOG("====== AUTH FAILED: node " << *curr << " malformed (antiparallel children source/sink mismatch) ======\n\n")
+                            return false;
+                        }
+                    }
+
+                    n_src[source]--;
+                    n_sink[sink]--;
+                    break;
+                case c_type::dangling:
+                    if (is_sp) {
+                        L_LOG("====== AUTH FAILED: illegal dangling composition in SP decomposition tree ======\n\n")
+                        return false;
+                    }
+
+                    if (swap) {
+                        if (rsource != source || rsink != sink || lsink != sink) {
+                            L_LOG("====== AUTH FAILED: node " << *curr << " malformed (dangling children source/sink mismatch) ======\n\n")
+                            return false;
+                        }
+                    } else {
+                        if (lsource != source || lsink != sink || rsource != source) {
+                            L_LOG("====== AUTH FAILED: node " << *curr << " malformed (dangling children source/sink mismatch) ======\n\n")
+                            return false;
+                        }
+                    }
+
+                    if (swap) {
+                        n_src[lsource]--;
+                        n_sink[sink]--;
+                    } else {
+                        n_src[source]--;
+                        n_sink[rsink]--;
+                    }
+
+                    break;
+            }
+
+            return true;
+        });
+        if (!well_formed) return false;
+
+        N_LOG("decomposition tree well-formed...\n")
+        n_src[decomposition.root->source]--;
+        n_sink[decomposition.root->sink]--;
+
+        bool failed = false;
+        for (idx_t i = 0; i < g.n; i++) {
+            if (n_src[i] != 0) {
+                N_LOG("OH NO: disconnected SP subgraph sourced at vertex " << i << "\n")
+                failed = true;
+            }
+            
+            if (n_sink[i] != 0) {
+                N_LOG("OH NO: disconnected SP subgraph sinked at vertex " << i << "\n")
+                failed = true;
+            }
+        }
+
+        if (failed) {
+            L_LOG("====== AUTH FAILED: additional disconnected SP subgraphs are part of the decomposition tree ======\n\n")
+            return false;
+        }
+
+        N_LOG("decomposition tree connected...\n")
+
+        for (idx_t i = 0; i < g.n; i++) {
+            std::vector<idx_t> l1(g.adj(i).begin(), g.adj(i).end());
+            radix_sort(l1);
+            radix_sort(produced[i]);
+            if (l1 != produced[i]) {
+                L_LOG("====== AUTH FAILED: vertex " << i << " of G does not have the same adjacency list as the one produced by the decomposition tree ======\n\n")
+
+                #ifdef __LOGGING__
+                N_LOG("ORIGINAL GRAPH: ")
+                g.output_adj_list(i, std::cout);
+                N_LOG("PRODUCED GRAPH: vertex " << i << " adjacencies: ")
+                for (idx_t v : produced[i]) N_LOG(v << " ")
+                N_LOG("\n")
+                #endif
+
+                L_LOG("======================================================================\n\n")
+                return false;                
+            }
+        }
+
+        N_LOG("decomposition tree produces graph identical to G...\n")
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+
+        this->verified = true;
+        return true;
+    }
+};
+
+template <typename idx_t>
+struct positive_cert_outerplanar : certificate_base {
+    // outer cycles of the bicomps, concatenated; cycle i is
+    // cycles[cycle_start[i]] .. cycles[cycle_start[i + 1] - 1]. a bridge is a
+    // two-vertex cycle
+    std::vector<idx_t> cycles;
+    std::vector<idx_t> cycle_start{0};
+
+    bool authenticate(graph<idx_t> const& g) {
+        if (this->verified) return true;
+
+        idx_t n_cycles = (idx_t)(cycle_start.size()) - 1;
+        L_LOG("====== AUTHENTICATE OUTERPLANAR EMBEDDING: " << n_cycles << " outer cycle" << (n_cycles == 1 ? "" : "s") << " ======\n")
+
+        if (n_cycles == 0 && g.n > 1) {
+            L_LOG("====== AUTH FAILED: no outer cycles given ======\n\n")
+            return false;
+        }
+
+        std::vector<idx_t> v_start((size_t)(g.n + 1), 0);
+        for (idx_t c = 0; c < n_cycles; c++) {
+            if (cycle_start[c + 1] - cycle_start[c] < 2) {
+                L_LOG("====== AUTH FAILED: outer cycle " << c << " has fewer than two vertices ======\n\n")
+                return false;
+            }
+
+            for (idx_t i = cycle_start[c]; i < cycle_start[c + 1]; i++) {
+                if (cycles[i] < 0 || cycles[i] >= g.n) {
+                    L_LOG("====== AUTH FAILED: outer cycle " << c << " contains invalid vertex " << cycles[i] << " ======\n\n")
+                    return false;
+                }
+                v_start[cycles[i] + 1]++;
+            }
+        }
+
+        for (idx_t v = 0; v < g.n; v++) v_start[v + 1] += v_start[v];
+        std::vector<idx_t> v_cycles((size_t)(v_start[g.n]));
+        std::vector<idx_t> fill(v_start.begin(), v_start.end() - 1);
+        for (idx_t c = 0; c < n_cycles; c++) {
+            for (idx_t i = cycle_start[c]; i < cycle_start[c + 1]; i++) v_cycles[fill[cycles[i]]++] = c;
+        }
+
+        // the cycles must meet in a tree-like fashion, as the bicomps do in the
+        // block-cut tree. each cycle records the vertex it was reached through,
+        // each vertex the cycle it was first reached in, so that "v lies on c"
+        // is answered in constant time below
+        std::vector<idx_t> home((size_t)(g.n), -1);
+        std::vector<idx_t> home_pos((size_t)(g.n), -1);
+        std::vector<idx_t> attach((size_t)(n_cycles), -2);
+        std::vector<idx_t> attach_pos((size_t)(n_cycles), -1);
+        std::stack<idx_t> bfs;
+
+        for (idx_t c0 = 0; c0 < n_cycles; c0++) {
+            if (attach[c0] != -2) continue;
+            attach[c0] = -1;
+            bfs.push(c0);
+
+            while (!bfs.empty()) {
+                idx_t c = bfs.top();
+                bfs.pop();
+
+                for (idx_t i = cycle_start[c]; i < cycle_start[c + 1]; i++) {
+                    idx_t v = cycles[i];
+                    if (v == attach[c]) {
+                        if (attach_pos[c] != -1) {
+                            L_LOG("====== AUTH FAILED: vertex " << v << " repeated on outer cycle " << c << " ======\n\n")
+                            return false;
+                        }
+                        attach_pos[c] = i - cycle_start[c];
+                        continue;
+                    }
+
+                    if (home[v] != -1) {
+                        L_LOG("====== AUTH FAILED: vertex " << v << " closes a cycle of outer cycles (or is repeated on one) ======\n\n")
+                        return false;
+                    }
+                    home[v] = c;
+                    home_pos[v] = i - cycle_start[c];
+
+                    for (idx_t j = v_start[v]; j < v_start[v + 1]; j++) {
+                        idx_t d = v_cycles[j];
+                        if (d == c) continue;
+                        if (attach[d] != -2) {
+                            L_LOG("====== AUTH FAILED: outer cycle " << d << " shares more than one vertex with the others ======\n\n")
+                            return false;
+                        }
+                        attach[d] = v;
+                        bfs.push(d);
+                    }
+                }
+            }
+        }
+
+        for (idx_t v = 0; v < g.n; v++) {
+            if (home[v] == -1 && g.n > 1) {
+                L_LOG("====== AUTH FAILED: vertex " << v << " lies on no outer cycle ======\n\n")
+                return false;
+            }
+        }
+
+        N_LOG("outer cycles form a tree...\n")
+
+        std::vector<idx_t> cycle_edges((size_t)(n_cycles), 0);
+        std::vector<std::pair<idx_t, idx_t>> chords;
+        idx_t n_edges = 0;
+
+        for (idx_t u = 0; u < g.n; u++) {
+            for (idx_t v : g.adj(u)) {
+                if (v < u) continue;
+                n_edges++;
+
+                idx_t c = home[u];
+                if (home[v] != c && attach[c] != v) {
+                    c = home[v];
+                    if (home[u] != c && attach[c] != u) {
+                        L_LOG("====== AUTH FAILED: edge (" << u << ", " << v << ") does not lie within any outer cycle ======\n\n")
+                        return false;
+                    }
+                }
+
+                idx_t len = cycle_start[c + 1] - cycle_start[c];
+                idx_t i = (home[u] == c ? home_pos[u] : attach_pos[c]);
+                idx_t j = (home[v] == c ? home_pos[v] : attach_pos[c]);
+                if (i > j) std::swap(i, j);
+
+                if (i == j) {
+                    L_LOG("====== AUTH FAILED: self loop at vertex " << u << " ======\n\n")
+                    return false;
+                } else if (j - i == 1 || (i == 0 && j == len - 1)) {
+                    cycle_edges[c]++;
+                } else {
+                    chords.emplace_back(cycle_start[c] + i, cycle_start[c] + j);
+                }
+            }
+        }
+
+        for (idx_t c = 0; c < n_cycles; c++) {
+            idx_t len = cycle_start[c + 1] - cycle_start[c];
+            if (cycle_edges[c] != (len == 2 ? 1 : len)) {
+                L_LOG("====== AUTH FAILED: outer cycle " << c << " uses " << (len == 2 ? 1 : len) - cycle_edges[c] << " edges not in the graph ======\n\n")
+                return false;
+            }
+        }
+
+        if (n_edges != g.e) {
+            L_LOG("====== AUTH FAILED: adjacency lists hold " << n_edges << " edges, expected " << g.e << " ======\n\n")
+            return false;
+        }
+
+        N_LOG("outer cycles and " << chords.size() << " chords cover the graph...\n")
+
+        // order the chords by left end ascending, then right end descending,
+        // with two counting sorts over cycle positions. nested chords then
+        // follow their enclosing chord, and a crossing is a chord ending past
+        // the innermost open one
+        std::vector<idx_t> count((size_t)(cycles.size() + 1));
+        std::vector<std::pair<idx_t, idx_t>> sorted(chords.size());
+        for (std::pair<idx_t, idx_t> ch : chords) count[cycles.size() - ch.second]++;
+        for (size_t i = 1; i < count.size(); i++) count[i] += count[i - 1];
+        for (size_t i = chords.size(); i-- > 0;) sorted[--count[cycles.size() - chords[i].second]] = chords[i];
+
+        std::fill(count.begin(), count.end(), 0);
+        for (std::pair<idx_t, idx_t> ch : sorted) count[ch.first]++;
+        for (size_t i = 1; i < count.size(); i++) count[i] += count[i - 1];
+        for (size_t i = sorted.size(); i-- > 0;) chords[--count[sorted[i].first]] = sorted[i];
+
+        std::stack<idx_t> open;
+        for (std::pair<idx_t, idx_t> ch : chords) {
+            while (!open.empty() && open.top() <= ch.first) open.pop();
+            if (!open.empty() && open.top() < ch.second) {
+                L_LOG("====== AUTH FAILED: chord (" << cycles[ch.first] << ", " << cycles[ch.second] << ") crosses another chord ======\n\n")
+                return false;
+            }
+            open.push(ch.second);
+        }
+
+        N_LOG("no two chords cross...\n")
+        L_LOG("====== AUTH SUCCESS ======\n\n")
+
+        this->verified = true;
+        return true;
+    }
+};
+
+template <typename idx_t>
+using certificate = std::variant<std::monostate,
+                                 negative_cert_K4<idx_t>,
+                                 negative_cert_K23<idx_t>,
+                                 negative_cert_T4<idx_t>,
+                                 negative_cert_tri_comp_cut<idx_t>,
+                                 negative_cert_tri_cut_comp<idx_t>,
+                                 negative_cert_edge_count<idx_t>,
+                                 negative_cert_min_degree<idx_t>,
+                                 negative_cert_disconnected<idx_t>,
+                                 positive_cert_sp<idx_t>,
+                                 positive_cert_outerplanar<idx_t>>;
+
+enum class verdict {sp, gsp, outerplanar};
+
+template <typename idx_t>
+struct sp_result {
+    bool is_sp = false;
+    bool is_gsp = false;
+    bool is_outerplanar = false;
+
+    // verdict v is settled by certs[slot[v]]: one certificate can settle
+    // several, as a K4 does all three
+    certificate<idx_t> certs[3];
+    int slot[3] = {0, 1, 2};
+
+    certificate<idx_t>& reason(verdict v) {return certs[slot[(int)(v)]];}
+    certificate<idx_t> const& reason(verdict v) const {return certs[slot[(int)(v)]];}
+    bool settled(verdict v) const {return reason(v).index() != 0;}
+
+    void settle(verdict v, certificate<idx_t>&& cert) {
+        trace(1, trace_kind::certificate, (int64_t)(v), (int64_t)(cert.index()));
+        slot[(int)(v)] = (int)(v);
+        certs[(int)(v)] = std::move(cert);
+    }
+    void share(verdict v, verdict with) {slot[(int)(v)] = slot[(int)(with)];}
+
+    bool authenticate(graph<idx_t> const& g) {
+        trace_scope scope{trace_span::authenticate};
+        L_LOG("================== AUTHENTICATING SP RESULT ==================\n") 
+        V_LOG(g)
+        V_LOG("=============================================================\n")
+        L_LOG("\n")
+
+        for (verdict v : {verdict::sp, verdict::gsp, verdict::outerplanar}) {
+            bool ok = std::visit([&](auto& cert) {
+                if constexpr (std::is_same_v<std::decay_t<decltype(cert)>, std::monostate>) {
+                    L_LOG("ERROR: reason not given")
+                    return false;
+                } else {
+                    return cert.authenticate(g);
+                }
+            }, reason(v));
+            if (!ok) return false;
+        }
+
+        L_LOG("this graph is " << (is_sp ? "" : "NOT ") << "SP\n")
+        L_LOG("this graph is " << (is_gsp ? "" : "NOT ") << "GSP\n")
+        L_LOG("this graph is " << (is_outerplanar ? "" : "NOT ") << "outerplanar\n")
+        return true;
+    }
+
+    // the GSP decomposition tree (the SP one when the graph is SP), kept for
+    // later use; null when the graph is not GSP
+    sp_tree<idx_t> const * decomposition() const {
+        positive_cert_sp<idx_t> const * sp = std::get_if<positive_cert_sp<idx_t>>(&reason(verdict::gsp));
+        return (sp && sp->decomposition.root) ? &(sp->decomposition) : nullptr;
+    }
+};
+
+// ==================== MAIN ALGORITHM FUNCTIONS ====================
+template <typename idx_t>
+void report_K4_non_stack_pop_case(sp_result<idx_t>& cert_out,
+                                  std::shared_ptr<std::vector<idx_t>> const& tree,
+                                  std::vector<sp_vertex<idx_t>>& vert,
+                                  sp_chain_stacks<idx_t>& stacks,
+                                  idx_t a, 
+                                  idx_t b,
+                                  idx_t d,
+                                  idx_t elose,
+                                  idx_t ewin_src,
+                                  idx_t ewin_sink) {
+    negative_cert_K4<idx_t> k4{};
+    k4.a = a;
+    k4.b = b;
+    k4.d = d;
+    k4.tree = tree;
+
+    sp_tree<idx_t> earliest_violating_ear;
+    for (idx_t bw = vert[k4.b].parent; bw != k4.d; bw = vert[bw].parent) {
+        for (idx_t& head = vert[bw].stack; head != -1; stacks.pop(head)) {
+            if (stacks.top(head).end == k4.a) {
+                earliest_violating_ear = std::move(stacks.top(head).SP);
+                k4.c = bw;
+            }
+        }
+    }
+
+    k4.ab.up(k4.a, k4.b);
+    k4.bc.up(k4.b, k4.c);
+    k4.cd.up(k4.c, k4.d);
+
+    k4.ad.edge(k4.d, elose);
+    k4.ad.up(elose, k4.a);
+    k4.bd.up(k4.d, ewin_src);
+    k4.bd.edge(ewin_src, ewin_sink);
+    k4.bd.up(ewin_sink, k4.b);
+    idx_t ear_path = earliest_violating_ear.underlying_tree_path_source();
+    k4.ac.edge(k4.c, ear_path);
+    k4.ac.up(ear_path, k4.a);
+
+    cert_out.settle(verdict::sp, std::move(k4));
+}
+
+template <typename idx_t>
+void K23_test(certificate<idx_t>& cert, std::vector<idx_t>& alert, std::shared_ptr<std::vector<idx_t>> const& tree, idx_t parent_w, edge_t<idx_t> ear_found, edge_t<idx_t> ear_winning, idx_t w) {
+    trace(2, trace_kind::k23_test, (int64_t)(w), (int64_t)(parent_w));
+    V_LOG("testing K23: found ear (" << ear_found.first << ", " << ear_found.second << "), winning ear (" << ear_winning.first << ", " << ear_winning.second << ")\n")
+    if (ear_found.second != parent_w || alert[w] != -1) {
+        negative_cert_K23<idx_t> k23{};
+        k23.a = w;
+        k23.b = ear_found.second;
+        k23.tree = tree;
+
+        k23.one.edge(k23.b, ear_found.first);
+        k23.one.up(ear_found.first, k23.a);
+
+        if (ear_found.second != parent_w) {
+            N_LOG("OOPS, 3.5(a) violation, nonouterplanar\n")
+            k23.two.up(k23.a, k23.b);
+        } else {
+            N_LOG("OOPS, 3.5(b) violation, nonouterplanar\n")
+            k23.two.edge(k23.b, alert[w]);
+            k23.two.up(alert[w], k23.a);
+        }
+
+        k23.three.up(k23.b, ear_winning.second);
+        k23.three.edge(ear_winning.second, ear_winning.first);
+        k23.three.up(ear_winning.first, k23.a);
+
+        cert = std::move(k23);
+        return;
+    }
+
+    alert[w] = ear_found.first;
+}
+
+// a dangling node's right subtree hangs off another bicomp, so within a bicomp
+// the node stands for its left subtree alone
+template <typename idx_t>
+sp_tree_node<idx_t> * bicomp_part(sp_tree_node<idx_t> * t) {
+    while (t->comp == c_type::dangling) t = t->l;
+    return t;
+}
+
+// appends the vertices of t, a bicomp decomposition tree or part of one, from
+// source to sink (sink to source if rev) along its outer face, to the path
+// begun at out[start]. the parallel children that are single edges are chords
+// and are skipped
+template <typename idx_t>
+void append_outer_path(sp_tree_node<idx_t> * t, bool rev, std::vector<idx_t>& out, size_t start) {
+    sp_tree_walk(t, rev, [](sp_tree_node<idx_t> * curr, bool swap) {
+        switch (curr->comp) {
+            case c_type::series:
+                return sp_walk_children<idx_t>{swap ? curr->r : curr->l, swap, swap ? curr->l : curr->r, swap};
+            case c_type::parallel:
+                return sp_walk_children<idx_t>{bicomp_part(curr->l)->comp != c_type::edge ? curr->l : curr->r, swap};
+            case c_type::antiparallel:
+                if (bicomp_part(curr->l)->comp != c_type::edge) return sp_walk_children<idx_t>{curr->l, swap};
+                return sp_walk_children<idx_t>{curr->r, !swap};
+            case c_type::dangling:
+                return sp_walk_children<idx_t>{curr->l, swap};
+            case c_type::edge:
+                break;
+        }
+        return sp_walk_children<idx_t>{};
+    }, [&](sp_tree_node<idx_t> * curr, sp_visit phase, bool swap) {
+        if (phase == sp_visit::pre && curr->comp == c_type::edge) {
+            idx_t first = (swap ? curr->sink : curr->source);
+            idx_t second = (swap ? curr->source : curr->sink);
+            if (out.size() == start || out.back() != first) out.push_back(first);
+            out.push_back(second);
+        }
+        return true;
+    });
+}
+
+// appends the outer cycle of one bicomp, read off the bicomp's own
+// decomposition tree: the parallel compositions at the top of the tree hold at
+// most two paths between the terminals (a third would be a K23), and the
+// cycle is the first path followed by the second one reversed
+template <typename idx_t>
+void append_outer_cycle(sp_tree<idx_t> const& t, positive_cert_outerplanar<idx_t>& op) {
+    std::vector<std::pair<sp_tree_node<idx_t> *, bool>> paths;
+    sp_tree_walk(t.root, false, [](sp_tree_node<idx_t> * curr, bool swap) {
+        switch (curr->comp) {
+            case c_type::parallel:
+                return sp_walk_children<idx_t>{curr->l, swap, curr->r, swap};
+            case c_type::antiparallel:
+                return sp_walk_children<idx_t>{curr->l, swap, curr->r, !swap};
+            case c_type::dangling:
+                return sp_walk_children<idx_t>{curr->l, swap};
+            case c_type::series:
+            case c_type::edge:
+                break;
+        }
+        return sp_walk_children<idx_t>{};
+    }, [&](sp_tree_node<idx_t> * curr, sp_visit phase, bool swap) {
+        if (phase == sp_visit::pre && curr->comp == c_type::series) paths.emplace_back(curr, swap);
+        return true;
+    });
+
+    size_t start = op.cycles.size();
+    if (paths.empty()) {
+        op.cycles.push_back(t.root->source);
+        op.cycles.push_back(t.root->sink);
+    }
+
+    for (size_t i = 0; i < paths.size(); i++) {
+        append_outer_path(paths[i].first, (i % 2 == 1) != paths[i].second, op.cycles, start);
+    }
+
+    if (op.cycles.size() > start + 2 && op.cycles.back() == op.cycles[start]) op.cycles.pop_back();
+    op.cycle_start.push_back((idx_t)(op.cycles.size()));
+
+    #ifdef __VERBOSE_LOGGING__
+    V_LOG("outer cycle: ")
+    for (size_t i = start; i < op.cycles.size(); i++) V_LOG(op.cycles[i] << " ")
+    V_LOG("\n")
+    #endif
+}
+
+// checks that the bicomps hanging from each bicomp (parent_bicomp, with the
+// root's bicomp last) attach through at most one vertex, two for the root's,
+// and lines them up as the chain SP_RECOGNITION walks. parent is the spanning
+// tree the bicomps were found on
+template <typename idx_t, typename tree_t>
+void chain_bicomps(std::vector<edge_t<idx_t>>& retval, std::vector<idx_t> const& parent_bicomp, tree_t const& parent, sp_result<idx_t>& cert_out) {
+    idx_t n_bicomps = (idx_t)(retval.size());
+    std::vector<idx_t> prev_cut((size_t)(n_bicomps), -1);
+    idx_t root_one = -1;
+    idx_t root_two = -1;
+
+    for (idx_t i = 0; i < n_bicomps - 1; i++) {
+        idx_t start = retval[i].first;
+        idx_t up = parent_bicomp[i];
+
+        if (up != n_bicomps - 1) {
+            V_LOG("found child bicomp: vertex " << start << " (bicomp " << i << ") child of vertex " << retval[up].first << " (bicomp " << up << ")\n")
+            if (prev_cut[up] == -1) {
+                prev_cut[up] = start;
+            } else {
+                negative_cert_tri_cut_comp<idx_t> cut{};
+                cut.c1 = retval[up].first;
+                cut.c2 = start;
+                cut.c3 = prev_cut[up];
+                N_LOG("NON-SP, bicomp (not at root) with three cut vertices: " << cut.c1 << ", " << cut.c2 << ", " << cut.c3 << "\n")
+                cert_out.settle(verdict::sp, std::move(cut));
+                cert_out.is_sp = false;
+                return;
+            }
+        } else {
+            V_LOG("found child bicomp of root: vertex " << start << " (bicomp " << i << ") child of bicomp " << n_bicomps - 1 << "\n")
+            if (root_one == -1) {
+                root_one = start;
+            } else if (root_two == -1) {
+                root_two = start;
+            } else {
+                negative_cert_tri_cut_comp<idx_t> cut{};
+                cut.c1 = root_one;
+                cut.c2 = root_two;
+                cut.c3 = start;
+                N_LOG("NON-SP, bicomp (at root) with three cut vertices: " << cut.c1 << ", " << cut.c2 << ", " << cut.c3 << "\n")
+                cert_out.settle(verdict::sp, std::move(cut));
+                cert_out.is_sp = false;
+                return;
+            }
+        }
+    }
+
+    N_LOG("no tri-cut-comp found\n")
+
+    if (n_bicomps > 1) {
+        N_LOG("ordering bicomps as chain: ")
+        idx_t second_endpoint = n_bicomps - 1;
+
+        for (idx_t i = 1; i < n_bicomps - 1; i++) {
+            if (prev_cut[i] == -1) {
+                second_endpoint = i;
+                break;
+            }
+        }
+
+        N_LOG("bicomp " << second_endpoint << " is the other bicomp with no child\n")
+
+        std::reverse(retval.begin() + second_endpoint, retval.end() - 1);
+        if (second_endpoint != n_bicomps - 1) {
+            retval.back().second = retval[n_bicomps - 2].first;
+            retval.back().first = retval[n_bicomps - 2].second;
+        } else {
+            if (retval.back().first == retval[n_bicomps - 2].first) {
+                retval.back().first = retval.back().second;
+            } else {
+                retval.back().first = parent[retval[n_bicomps - 2].first];
+            }
+            retval.back().second = retval[n_bicomps - 2].first;
+        }
+
+        for (idx_t i = second_endpoint; i < n_bicomps - 1; i++) {
+            retval[i].second = parent[retval[i].first];
+        }
+
+        #ifdef __VERBOSE_LOGGING__
+            for (idx_t i = 0; i < n_bicomps; i++) {
+                V_LOG("bicomp " << i << " after reordering: root " << retval[i].first << ", edge " << retval[i].second << "\n")
+            }
+        #endif
+    }
+}
+
+template <typename idx_t>
+idx_t uf_find(std::vector<std::atomic<idx_t>>& uf, idx_t v) {
+    while (true) {
+        idx_t p = uf[v].load(std::memory_order_relaxed);
+        if (p == v) return v;
+        idx_t gp = uf[p].load(std::memory_order_relaxed);
+        if (p != gp) uf[v].compare_exchange_weak(p, gp, std::memory_order_relaxed);
+        v = gp;
+    }
+}
+
+// links the larger root under the smaller, so concurrent unions cannot cycle
+template <typename idx_t>
+void uf_union(std::vector<std::atomic<idx_t>>& uf, idx_t a, idx_t b) {
+    while (true) {
+        a = uf_find(uf, a);
+        b = uf_find(uf, b);
+        if (a == b) return;
+        if (a < b) std::swap(a, b);
+        idx_t expected = a;
+        if (uf[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+    }
+}
+
+// the bicomps on many threads, in the style of Tarjan and Vishkin: a bfs
+// spanning tree, preorder numbers and subtree sizes by levels, low and high
+// (the lowest and highest preorder numbers reached from a subtree by a
+// non-tree edge), then the bicomps as connected components of the tree edges,
+// joined by
+//   (a) a non-tree edge between two unrelated subtrees, and
+//   (b) a tree edge and its parent's, when the subtree below escapes the
+//       parent's subtree.
+// each bicomp is named by its highest tree edge (top, child), and the bicomps
+// are listed children first, in the order a dfs (sp_single_pass's) closes them
+template <typename idx_t>
+std::vector<edge_t<idx_t>> get_bicomps_parallel(graph<idx_t> const& g, std::vector<idx_t>& cut_verts, sp_result<idx_t>& cert_out, int threads, idx_t root = 0) {
+    std::vector<edge_t<idx_t>> retval;
+    std::vector<std::atomic<idx_t>> claim((size_t)(g.n));
+    std::vector<idx_t> parent((size_t)(g.n), -1);
+    std::vector<idx_t> order;
+    std::vector<idx_t> level_start{0, 1};
+    order.reserve((size_t)(g.n));
+
+    parallel_blocks<idx_t>(0, g.n, threads, [&](idx_t lo, idx_t hi) {
+        for (idx_t v = lo; v < hi; v++) claim[v].store(-1, std::memory_order_relaxed);
+    });
+
+    claim[root].store(root, std::memory_order_relaxed);
+    order.push_back(root);
+
+    // bfs, one level at a time. each block of the frontier gathers the
+    // vertices it claims, so the children of a vertex end up next to each
+    // other in order
+    while (level_start.back() > level_start[level_start.size() - 2]) {
+        idx_t lo = level_start[level_start.size() - 2];
+        idx_t hi = level_start.back();
+        std::vector<std::vector<idx_t>> found;
+        std::vector<idx_t> found_at;
+        std::mutex found_lock;
+
+        parallel_blocks<idx_t>(lo, hi, threads, [&](idx_t blo, idx_t bhi) {
+            std::vector<idx_t> local;
+            for (idx_t i = blo; i < bhi; i++) {
+                idx_t w = order[i];
+                for (idx_t u : g.adj(w)) {
+                    idx_t expected = -1;
+                    if (claim[u].load(std::memory_order_relaxed) == -1
+                        && claim[u].compare_exchange_strong(expected, w, std::memory_order_relaxed)) {
+                        local.push_back(u);
+                    }
+                }
+            }
+            std::lock_guard<std::mutex> guard(found_lock);
+            found.push_back(std::move(local));
+            found_at.push_back(blo);
+        });
+
+        std::vector<size_t> by_start(found.size());
+        for (size_t k = 0; k < found.size(); k++) by_start[k] = k;
+        std::sort(by_start.begin(), by_start.end(), [&](size_t x, size_t y) { return found_at[x] < found_at[y]; });
+        for (size_t k : by_start) order.insert(order.end(), found[k].begin(), found[k].end());
+        level_start.push_back((idx_t)(order.size()));
+    }
+    level_start.pop_back();
+
+    idx_t n_reached = (idx_t)(order.size());
+    idx_t n_levels = (idx_t)(level_start.size()) - 1;
+    std::vector<idx_t> child_begin((size_t)(g.n), 0);
+    std::vector<idx_t> child_end((size_t)(g.n), 0);
+
+    parallel_blocks<idx_t>(1, n_reached, threads, [&](idx_t lo, idx_t hi) {
+        for (idx_t i = lo; i < hi; i++) {
+            idx_t v = order[i];
+            parent[v] = claim[v].load(std::memory_order_relaxed);
+        }
+    });
+    parallel_blocks<idx_t>(1, n_reached, threads, [&](idx_t lo, idx_t hi) {
+        for (idx_t i = lo; i < hi; i++) {
+            idx_t p = parent[order[i]];
+            if (i == 1 || parent[order[i - 1]] != p) child_begin[p] = i;
+            if (i == n_reached - 1 || parent[order[i + 1]] != p) child_end[p] = i + 1;
+        }
+    });
+
+    // subtree sizes bottom-up, then preorder numbers top-down
+    std::vector<idx_t> nd((size_t)(g.n), 1);
+    std::vector<idx_t> pre((size_t)(g.n), 0);
+
+    for (idx_t l = n_levels - 1; l >= 0; l--) {
+        parallel_blocks<idx_t>(level_start[l], level_start[l + 1], threads, [&](idx_t lo, idx_t hi) {
+            for (idx_t i = lo; i < hi; i++) {
+                idx_t v = order[i];
+                for (idx_t c = child_begin[v]; c < child_end[v]; c++) nd[v] += nd[order[c]];
+            }
+        });
+    }
+
+    for (idx_t l = 0; l < n_levels; l++) {
+        parallel_blocks<idx_t>(level_start[l], level_start[l + 1], threads, [&](idx_t lo, idx_t hi) {
+            for (idx_t i = lo; i < hi; i++) {
+                idx_t v = order[i];
+                idx_t next = pre[v] + 1;
+                for (idx_t c = child_begin[v]; c < child_end[v]; c++) {
+                    pre[order[c]] = next;
+                    next += nd[order[c]];
+                }
+            }
+        });
+    }
+
+    // low and high: each vertex's own non-tree edges, then subtrees bottom-up
+    std::vector<idx_t> low((size_t)(g.n));
+    std::vector<idx_t> high((size_t)(g.n));
+
+    parallel_blocks<idx_t>(0, n_reached, threads, [&](idx_t lo, idx_t hi) {
+        for (idx_t i = lo; i < hi; i++) {
+            idx_t v = order[i];
+            low[v] = high[v] = pre[v];
+            for (idx_t u : g.adj(v)) {
+                if (u == parent[v] || parent[u] == v) continue;
+                low[v] = std::min(low[v], pre[u]);
+                high[v] = std::max(high[v], pre[u]);
+            }
+        }
+    });
+
+    for (idx_t l = n_levels - 1; l >= 0; l--) {
+        parallel_blocks<idx_t>(level_start[l], level_start[l + 1], threads, [&](idx_t lo, idx_t hi) {
+            for (idx_t i = lo; i < hi; i++) {
+                idx_t v = order[i];
+                for (idx_t c = child_begin[v]; c < child_end[v]; c++) {
+                    low[v] = std::min(low[v], low[order[c]]);
+                    high[v] = std::max(high[v], high[order[c]]);
+                }
+            }
+        });
+    }
+
+    // tree edges (p, v) are named by v; uf links them into bicomps
+    std::vector<std::atomic<idx_t>> uf((size_t)(g.n));
+    parallel_blocks<idx_t>(0, g.n, threads, [&](idx_t lo, idx_t hi) {
+        for (idx_t v = lo; v < hi; v++) uf[v].store(v, std::memory_order_relaxed);
+    });
+
+    parallel_blocks<idx_t>(1, n_reached, threads, [&](idx_t lo, idx_t hi) {
+        for (idx_t i = lo; i < hi; i++) {
+            idx_t v = order[i];
+            idx_t p = parent[v];
+
+            for (idx_t u : g.adj(v)) {
+                if (u == p || parent[u] == v) continue;
+                if (pre[v] < pre[u] && pre[u] >= pre[v] + nd[v]) uf_union(uf, v, u);
+            }
+
+            if (p != root && (low[v] < pre[p] || high[v] >= pre[p] + nd[p])) uf_union(uf, v, p);
+        }
+    });
+
+    // each bicomp's highest tree edge: the member with the lowest preorder
+    // number, which bfs order meets first
+    std::vector<idx_t> bicomp_of((size_t)(g.n), -1);
+    std::vector<idx_t> top_child;
+    for (idx_t i = 1; i < n_reached; i++) {
+        idx_t v = order[i];
+        idx_t rep = uf_find(uf, v);
+        if (bicomp_of[rep] == -1) {
+            bicomp_of[rep] = (idx_t)(top_child.size());
+            top_child.push_back(v);
+        }
+    }
+
+    idx_t n_bicomps = (idx_t)(top_child.size());
+    N_LOG(n_bicomps << " bicomp" << (n_bicomps == 1 ? "" : "s") << " found on " << threads << " threads\n")
+    if (n_bicomps == 0) return retval;
+
+    // the block tree: a bicomp hangs from the bicomp of its top's tree edge.
+    // the root's first bicomp is the root of the block tree, and a second one
+    // hangs from it, listed first as the dfs would have finished it first
+    std::vector<idx_t> heads((size_t)(g.n), 0);
+    std::vector<idx_t> up((size_t)(n_bicomps), -1);
+    std::vector<idx_t> first_child((size_t)(n_bicomps), -1);
+    std::vector<idx_t> next_sibling((size_t)(n_bicomps), -1);
+    idx_t top_bicomp = -1;
+
+    for (idx_t b = 0; b < n_bicomps; b++) {
+        idx_t top = parent[top_child[b]];
+        heads[top]++;
+
+        if (top != root) {
+            up[b] = bicomp_of[uf_find(uf, top)];
+        } else if (top_bicomp == -1) {
+            top_bicomp = b;
+        } else {
+            up[b] = top_bicomp;
+        }
+
+        if (up[b] != -1 && top != root) {
+            next_sibling[b] = first_child[up[b]];
+            first_child[up[b]] = b;
+        }
+    }
+
+    for (idx_t b = 0; b < n_bicomps; b++) {
+        if (up[b] != -1 && parent[top_child[b]] == root) {
+            next_sibling[b] = first_child[up[b]];
+            first_child[up[b]] = b;
+        }
+    }
+
+    // post-order of the block tree, which is the order the dfs finishes them in
+    std::vector<idx_t> index_of((size_t)(n_bicomps));
+    std::stack<std::pair<idx_t, idx_t>> hist;
+    hist.emplace(top_bicomp, first_child[top_bicomp]);
+
+    while (!hist.empty()) {
+        idx_t b = hist.top().first;
+        idx_t c = hist.top().second;
+        if (c != -1) {
+            hist.top().second = next_sibling[c];
+            hist.emplace(c, first_child[c]);
+        } else {
+            index_of[b] = (idx_t)(retval.size());
+            retval.emplace_back(parent[top_child[b]], top_child[b]);
+            hist.pop();
+        }
+    }
+
+    for (idx_t i = 0; i < n_bicomps; i++) {
+        idx_t w = retval[i].first;
+        if (w == root) {
+            if (cut_verts[root] == -1) cut_verts[root] = i;
+        } else if (cut_verts[w] == -1) {
+            cut_verts[w] = i;
+        } else if (!cert_out.settled(verdict::sp)) {
+            N_LOG("NON-SP, three component cut vertex at " << w << "\n")
+            negative_cert_tri_comp_cut<idx_t> cut{};
+            cut.v = w;
+            cert_out.settle(verdict::sp, std::move(cut));
+            cert_out.is_sp = false;
+        }
+    }
+
+    if (heads[root] > 2 && !cert_out.settled(verdict::sp)) {
+        N_LOG("NON-SP, three component cut vertex at " << root << "\n")
+        negative_cert_tri_comp_cut<idx_t> cut{};
+        cut.v = root;
+        cert_out.settle(verdict::sp, std::move(cut));
+        cert_out.is_sp = false;
+    }
+
+    if (heads[root] < 2) cut_verts[root] = -1;
+    if (cert_out.settled(verdict::sp)) return retval;
+
+    N_LOG("no tri-comp-cut found\n")
+
+    std::vector<idx_t> parent_bicomp((size_t)(n_bicomps), n_bicomps - 1);
+    for (idx_t b = 0; b < n_bicomps; b++) {
+        if (up[b] != -1 && up[b] != top_bicomp) parent_bicomp[index_of[b]] = index_of[up[b]];
+    }
+
+    chain_bicomps(retval, parent_bicomp, parent, cert_out);
+    return retval;
+}
+
+// per-vertex state of the ear decomposition (the paper's seq, ear and vertex
+// stacks) and the steps that update it. dfs_no and parent are those of the dfs
+// driving it, which runs over one bicomp at a time or over the whole graph
+template <typename idx_t>
+struct sp_ear_state {
+    graph<idx_t> const& g;
+    sp_result<idx_t>& retval;
+    std::vector<idx_t> const& cut_verts;
+
+    std::vector<sp_tree<idx_t>> cut_vertex_attached_tree;
+    std::vector<sp_vertex<idx_t>> vert; // and a sentinel past the last vertex, numbered after all of them
+    vertex_parents<idx_t> parent{vert};
+    sp_chain_stacks<idx_t> stacks;
+    std::vector<idx_t> alert; // read by the K23 test alone, so kept out of the records
+
+    // the parent array the certificates walk: copied out of the records once
+    // the ear state is done, if a certificate still holds it
+    std::shared_ptr<std::vector<idx_t>> tree;
+
+    positive_cert_outerplanar<idx_t> op;
+    std::optional<sp_tree_audit<idx_t>> audit; // with --fused
+
+    sp_ear_state(graph<idx_t> const& g_, sp_result<idx_t>& retval_, std::vector<idx_t> const& cut_verts_, idx_t n_bicomps, bool fused = false)
+        : g{g_}, retval{retval_}, cut_verts{cut_verts_}, cut_vertex_attached_tree((size_t)(n_bicomps)), vert((size_t)(g.n) + 1),
+          alert((size_t)(g.n), -1), tree{std::make_shared<std::vector<idx_t>>()} {
+        for (sp_vertex<idx_t>& x : vert) {
+            x.ear = edge_t<idx_t>{g.n, g.n};
+            x.earliest_outgoing = g.n;
+        }
+        vert[g.n].dfs_no = g.n + 1;
+        if (fused) audit.emplace(vert);
+    }
+
+    sp_ear_state(sp_ear_state<idx_t> const& other) = delete;
+    sp_ear_state<idx_t>& operator=(sp_ear_state<idx_t> const& other) = delete;
+
+    ~sp_ear_state() {
+        if (tree.use_count() == 1) return;
+        tree->resize((size_t)(g.n));
+        for (idx_t i = 0; i < g.n; i++) (*tree)[i] = vert[i].parent;
+    }
+
+    void enter(idx_t u, idx_t w, idx_t slot, idx_t number) {
+        vert[u].parent = w;
+        vert[u].parent_slot = slot;
+        vert[u].dfs_no = number;
+    }
+
+    void reset(idx_t i) {
+        vert[i].dfs_no = 0;
+        vert[i].parent = 0;
+        vert[i].ear = edge_t<idx_t>{g.n, g.n};
+        alert[i] = -1;
+        vert[i].earliest_outgoing = g.n;
+        vert[i].seq = sp_tree<idx_t>{};
+        stacks.clear(vert[i].stack);
+    }
+
+    // w meets u, already visited, at adj(w)[slot]: a dfs child that is done or
+    // a back edge up is merged into w's seq and ear. false once a K4 is found
+    bool absorb(idx_t w, idx_t u, idx_t slot) {
+        idx_t v = vert[w].parent;
+        V_LOG("v: " << v << " w: " << w << " u: " << u << "\n")
+        V_LOG("seq_w: " << vert[w].seq << ", seq_u: " << vert[u].seq << "\n")
+
+        bool child_back_edge = (vert[u].dfs_no < vert[w].dfs_no && u != v);
+        #ifdef __LOGGING__
+            if (child_back_edge) N_LOG("BACK EDGE (" << w << ", " << u << ")\n")
+        #endif
+
+        if (vert[u].parent == w) {
+            N_LOG("tree edge (" << w << ", " << u << ")\n")
+            // --- update-seq in the paper begins here ---
+            for (idx_t& head = vert[w].stack; head != -1; stacks.pop(head)) {
+                if (vert[u].seq.source() != stacks.top(head).end) {
+                    N_LOG("OOPS, 3.4b due to POPPING STACK child seq " << vert[u].seq << " parent seq " << vert[w].seq << "\n")
+                    negative_cert_K4<idx_t> k4{};
+
+                    k4.b = vert[u].seq.source();
+                    k4.a = stacks.top(head).end;
+                    k4.c = w;
+                    k4.tree = tree;
+                    edge_t<idx_t> holding_ear = vert[u].ear;
+
+                    k4.ab.up(k4.a, k4.b);
+                    k4.bc.up(k4.b, k4.c);
+
+                    k4.d = -1;
+                    for (idx_t c = k4.c; k4.d == -1;) {
+                        c = vert[c].parent;
+
+                        for (idx_t& at = vert[c].stack; at != -1; stacks.pop(at)) {
+                            if (stacks.top(at).end == k4.b) {
+                                k4.d = c;
+                                break;
+                            }
+                        }
+                    }
+                    k4.cd.up(k4.c, k4.d);
+
+                    k4.ad.up(k4.d, holding_ear.second);
+                    k4.ad.edge(holding_ear.second, holding_ear.first);
+                    k4.ad.up(holding_ear.first, k4.a);
+
+                    idx_t ear1 = stacks.top(vert[k4.d].stack).SP.underlying_tree_path_source();
+                    k4.bd.edge(k4.d, ear1);
+                    k4.bd.up(ear1, k4.b);
+                    idx_t ear2 = stacks.top(vert[k4.c].stack).SP.underlying_tree_path_source();
+                    k4.ac.edge(k4.c, ear2);
+                    k4.ac.up(ear2, k4.a);
+
+                    retval.settle(verdict::sp, std::move(k4));
+                    return false;
+                }
+
+                vert[u].seq.compose(std::move(stacks.top(head).SP), c_type::antiparallel);
+                vert[u].seq.l_compose(std::move(stacks.top(head).tail), c_type::series);
+            }
+            // ---- update-seq in the paper ends here ----
+        }
+
+        if (vert[u].parent == w || child_back_edge) {
+            // ---- update-ear-of-parent in the paper begins here ----
+            edge_t<idx_t> ear_f = (child_back_edge ? edge_t<idx_t>{w, u} : vert[u].ear);
+            sp_tree<idx_t> seq_u = (child_back_edge ? sp_tree<idx_t>{u, w, slot} : std::move(vert[u].seq));
+
+            if (vert[ear_f.second].dfs_no < vert[vert[w].ear.second].dfs_no) {
+                if (vert[w].ear.first != g.n) {
+                    if (!retval.settled(verdict::outerplanar) && vert[w].ear.first != w) K23_test(retval.reason(verdict::outerplanar), alert, tree, vert[w].parent, vert[w].ear, ear_f, w);
+                    if (vert[w].seq.source() != vert[w].ear.second) {
+                        N_LOG("OOPS, 3.4a due to CASE B prev winner " << vert[w].seq << " prev winner ear (" << vert[w].ear.first << ", " << vert[w].ear.second << ")\n")
+                        report_K4_non_stack_pop_case(retval, tree, vert, stacks, vert[w].seq.source(), w, vert[w].ear.second, vert[w].ear.first, ear_f.second, ear_f.first);
+                        return false;
+                    }
+
+                    N_LOG("CASE B (ear exists): placed " << vert[w].seq << " onto stk " << vert[w].ear.second << "\n")
+                    stacks.push(vert[vert[w].ear.second].stack, std::move(vert[w].seq), w);
+                    vert[w].earliest_outgoing = vert[w].ear.second;
+                }
+                vert[w].ear = ear_f;
+                trace(2, trace_kind::ear, (int64_t)(w), (int64_t)(ear_f.first), (int64_t)(ear_f.second));
+                vert[w].seq = std::move(seq_u);
+                N_LOG("CASE B (replace seq): current winning seq " << vert[w].seq << "\n")
+            } else {
+                if (seq_u.source() != ear_f.second) {
+                    N_LOG("OOPS, 3.4a/b due to CASE A/C child seq " << seq_u << " child ear (" << ear_f.first << ", " << ear_f.second << ")\n")
+                    report_K4_non_stack_pop_case(retval, tree, vert, stacks, seq_u.source(), w, ear_f.second, ear_f.first, vert[w].ear.second, vert[w].ear.first);
+                    return false;
+                }
+
+                if (vert[ear_f.second].dfs_no == vert[vert[w].ear.second].dfs_no) {
+                    if (!retval.settled(verdict::outerplanar) && !child_back_edge && vert[w].ear.first != w) K23_test(retval.reason(verdict::outerplanar), alert, tree, vert[w].parent, ear_f, vert[w].ear, w);
+
+                    if (vert[w].seq.source() != vert[w].ear.second) {
+                        N_LOG("OOPS, 3.4a/b due to CASE C parent seq " << vert[w].seq << " parent ear (" << vert[w].ear.first << ", " << vert[w].ear.second << ")\n")
+                        report_K4_non_stack_pop_case(retval, tree, vert, stacks, vert[w].seq.source(), w, vert[w].ear.second, vert[w].ear.first, ear_f.second, ear_f.first);
+                        return false;
+                    }
+                    vert[w].seq.compose(std::move(seq_u), c_type::parallel);
+                    N_LOG("CASE C: current winning seq after merge " << vert[w].seq << "\n")
+
+                    if ((vert[w].ear.first == w || vert[ear_f.first].dfs_no < vert[vert[w].ear.first].dfs_no) && ear_f.first != w) {
+                        vert[w].ear = ear_f;
+                        trace(2, trace_kind::ear, (int64_t)(w), (int64_t)(ear_f.first), (int64_t)(ear_f.second));
+                    }
+                } else {
+                    if (!retval.settled(verdict::outerplanar) && !child_back_edge) K23_test(retval.reason(verdict::outerplanar), alert, tree, vert[w].parent, ear_f, vert[w].ear, w);
+
+                    if (vert[ear_f.second].stack != -1 && stacks.top(vert[ear_f.second].stack).end == w) {
+                        N_LOG("CASE A (merge onto existing stack entry for stk " << ear_f.second << "): current child seq before merge " << seq_u << "\n")
+                        stacks.top(vert[ear_f.second].stack).SP.compose(std::move(seq_u), c_type::parallel);
+                    } else {
+                        N_LOG("CASE A (new stack entry): placed " << seq_u << " onto stk " << ear_f.second << " (earliest outgoing " << vert[w].earliest_outgoing << ")\n")
+                        stacks.push(vert[ear_f.second].stack, std::move(seq_u), w);
+                        if (vert[ear_f.second].dfs_no < vert[vert[w].earliest_outgoing].dfs_no) {
+                            vert[w].earliest_outgoing = ear_f.second;
+                        }
+                    }
+                }
+            }
+            // ----- update-ear-of-parent in the paper ends here -----
+        }
+
+        return true;
+    }
+
+    // the winning seq of w, once w is done, becomes the tail of the stack
+    // entry of w's earliest outgoing ear
+    void stash(idx_t w) {
+        if (vert[w].earliest_outgoing != g.n) {
+            N_LOG("EARLIEST OUTGOING " << vert[w].earliest_outgoing << ": moved current winning seq " << vert[w].seq << " to vertex stack entry tail with SP " << stacks.top(vert[vert[w].earliest_outgoing].stack).SP << "\n")
+            stacks.top(vert[vert[w].earliest_outgoing].stack).tail = std::move(vert[w].seq);
+        }
+    }
+
+    // w, below the bicomp's root, is done: its seq extends over the tree edge
+    // to its parent, with the bicomps hanging from w in between
+    void finish(idx_t w) {
+        idx_t v = vert[w].parent;
+        stash(w);
+        if (cut_verts[w] != -1) {
+            cut_vertex_attached_tree[cut_verts[w]].l_compose(sp_tree<idx_t>{w, v, vert[w].parent_slot}, c_type::dangling);
+            vert[w].seq.compose(std::move(cut_vertex_attached_tree[cut_verts[w]]), c_type::series);
+        } else {
+            vert[w].seq.compose(sp_tree<idx_t>{w, v, vert[w].parent_slot}, c_type::series);
+        }
+    }
+
+    // next, the root's only child in the bicomp, is done: its seq closes into
+    // the bicomp's decomposition tree with root_edge, empty for a fake edge
+    void close(idx_t next, sp_tree<idx_t>&& root_edge) {
+        stash(next);
+        vert[next].seq.compose(std::move(root_edge), c_type::parallel);
+        if (!retval.settled(verdict::outerplanar)) append_outer_cycle(vert[next].seq, op);
+
+        if (cut_verts[next] != -1) {
+            vert[next].seq.compose(std::move(cut_vertex_attached_tree[cut_verts[next]]), c_type::series);
+        }
+    }
+
+    // the bicomp below root, through next, is closed: it takes in what hangs
+    // from root so far and hangs there in its place
+    void hang(idx_t root, idx_t next) {
+        #ifdef __VERBOSE_LOGGING__
+        if (cut_vertex_attached_tree[cut_verts[root]].root) {
+            V_LOG("combine tree " << cut_vertex_attached_tree[cut_verts[root]] << " with " << vert[next].seq << "\n");
+        }
+        #endif
+
+        vert[next].seq.compose(std::move(cut_vertex_attached_tree[cut_verts[root]]), c_type::dangling);
+        V_LOG("ATTACH " << vert[next].seq << " to cut vertex " << root << "\n");
+        cut_vertex_attached_tree[cut_verts[root]] = std::move(vert[next].seq);
+    }
+
+    // the whole graph's decomposition tree is done: it certifies GSP, and SP
+    // too unless that has already failed
+    void settle(sp_tree<idx_t>&& decomposition) {
+        positive_cert_sp<idx_t> sp{};
+
+        sp.decomposition = std::move(decomposition);
+        sp.is_sp = !retval.settled(verdict::sp);
+        sp.verified = audit && audit->passes(g, sp.decomposition, sp.is_sp);
+        retval.settle(verdict::gsp, std::move(sp));
+        retval.is_gsp = true;
+        N_LOG("graph is GSP\n")
+
+        if (!retval.settled(verdict::sp)) {
+            retval.share(verdict::sp, verdict::gsp);
+            retval.is_sp = true;
+            N_LOG("graph is SP\n")
+        }
+
+        if (!retval.settled(verdict::outerplanar)) {
+            retval.settle(verdict::outerplanar, std::move(op));
+            retval.is_outerplanar = true;
+            N_LOG("graph is outerplanar\n")
+        }
+    }
+};
+
+// recognition in a single dfs: low points find the bicomps, and each bicomp's
+// ear decomposition runs within the same dfs, rooted at its cut vertex and
+// entered through its tree edge, and is finished as soon as its low point
+// closes.
+// that settles GSP and outerplanarity, and SP unless the graph is GSP with
+// several bicomps and none of them attaches at three vertices: only then must
+// the chain of bicomps be rerun as two-terminal graphs. returns whether the
+// result is settled; if not, bicomps and cut_verts are left as the chain pass
+// expects them
+template <typename idx_t>
+bool sp_single_pass(graph<idx_t> const& g, std::vector<idx_t>& cut_verts, std::vector<edge_t<idx_t>>& bicomps, sp_result<idx_t>& retval, bool fused = false, idx_t root = 0) {
+    sp_result<idx_t> cut_out{};
+    sp_ear_state<idx_t> ears{g, retval, cut_verts, std::max<idx_t>(g.n, 1), fused};
+    std::stack<std::pair<idx_t, neighbor_cursor<idx_t>>> dfs;
+
+    if (!g.adj(root).size()) return true;
+
+    dfs.emplace(root, g.adj(root).begin());
+    ears.enter(root, -1, -1, 1);
+    ears.vert[root].low = 1;
+    idx_t curr_dfs = 2;
+    bool root_cut = false;
+
+    while (!dfs.empty()) {
+        idx_t w = dfs.top().first;
+        neighbor_cursor<idx_t>& at = dfs.top().second;
+        idx_t u = *at;
+        sp_vertex<idx_t>& at_u = ears.vert[u];
+
+        if (at_u.dfs_no == 0) {
+            ears.enter(u, w, at.slot, curr_dfs);
+            dfs.emplace(u, g.adj(u).begin());
+            at_u.low = curr_dfs++;
+            continue;
+        }
+
+        // edges into the bicomps below w were settled when those closed
+        sp_vertex<idx_t>& at_w = ears.vert[w];
+        if (w != root && (at_u.parent != w || at_u.low < at_w.dfs_no) && !ears.absorb(w, u, at.slot)) break;
+
+        if (at_u.parent == w) {
+            if (at_u.low < at_w.low) at_w.low = at_u.low;
+        } else if (at_u.dfs_no < at_w.dfs_no && u != at_w.parent) {
+            if (at_u.dfs_no < at_w.low) at_w.low = at_u.dfs_no;
+        }
+
+        if (!(++at).done()) continue;
+        dfs.pop();
+        if (w == root) continue;
+
+        idx_t v = ears.parent[w];
+        if (ears.vert[w].low < ears.vert[v].dfs_no) {
+            ears.finish(w);
+            continue;
+        }
+
+        // w is the first vertex of a bicomp below v, now closed
+        N_LOG("BICOMP " << bicomps.size() << ": root " << v << ", edge " << w << "\n")
+        if (cut_verts[v] != -1) {
+            if (v != root || root_cut) {
+                if (!cut_out.settled(verdict::sp)) {
+                    N_LOG("NON-SP, three component cut vertex at " << v << "\n")
+                    negative_cert_tri_comp_cut<idx_t> cut{};
+                    cut.v = v;
+                    cut_out.settle(verdict::sp, std::move(cut));
+                }
+            } else {
+                root_cut = true;
+            }
+        } else {
+            cut_verts[v] = (idx_t)(bicomps.size());
+        }
+        bicomps.emplace_back(v, w);
+        trace(1, trace_kind::bicomp, (int64_t)(v), (int64_t)(w));
+
+        ears.close(w, sp_tree<idx_t>{v, w, g.slot_of(w, v)});
+        ears.hang(v, w);
+    }
+
+    if (std::holds_alternative<negative_cert_K4<idx_t>>(retval.reason(verdict::sp))) {
+        N_LOG("K4 found, graph is not GSP\n")
+        retval.share(verdict::gsp, verdict::sp);
+        if (!retval.settled(verdict::outerplanar)) retval.share(verdict::outerplanar, verdict::sp);
+        return true;
+    }
+
+    idx_t n_bicomps = (idx_t)(bicomps.size());
+    N_LOG(n_bicomps << " bicomp" << (n_bicomps == 1 ? "" : "s") << " found\n")
+    if (!retval.settled(verdict::outerplanar)) {
+        N_LOG("no K23 found\n")
+    }
+
+    retval.settle(verdict::sp, std::move(cut_out.reason(verdict::sp)));
+    sp_tree<idx_t> decomposition = std::move(ears.cut_vertex_attached_tree[cut_verts[root]]);
+    if (!root_cut) cut_verts[root] = -1;
+
+    if (!retval.settled(verdict::sp) && n_bicomps > 1) {
+        N_LOG("no tri-comp-cut found\n")
+
+        // the bicomp each one hangs from: found by walking up the dfs tree to the
+        // first vertex heading a bicomp through the same tree edge, or the root's
+        vertex_parents<idx_t> const& parent = ears.parent;
+        std::vector<idx_t> parent_bicomp((size_t)(n_bicomps), n_bicomps - 1);
+
+        for (idx_t i = 0; i < n_bicomps - 1; i++) {
+            idx_t w = bicomps[i].first;
+            idx_t u = -1;
+
+            while (w != root) {
+                u = w;
+                w = parent[w];
+                V_LOG("walking up tree for bicomp " << i << ", w: " << w << ", u: " << u <<"\n")
+
+                if (cut_verts[w] != -1 && u == bicomps[cut_verts[w]].second) {
+                    parent_bicomp[i] = cut_verts[w];
+                    break;
+                }
+            }
+        }
+
+        chain_bicomps(bicomps, parent_bicomp, parent, retval);
+        if (!retval.settled(verdict::sp)) return false;
+    }
+
+    ears.settle(std::move(decomposition));
+    return true;
+}
+
+// cheap rejections, all three verdicts NO with a certificate that takes
+// one pass to check. a simple graph with more than 2n - 3 edges is out
+template <typename idx_t>
+bool sp_header_prefilter(graph_header const& h, sp_result<idx_t>& result) {
+    if (h.n < 2 || h.e <= 2 * h.n - 3) return false;
+    negative_cert_edge_count<idx_t> cert{};
+    cert.n = h.n;
+    cert.e = h.e;
+    result = sp_result<idx_t>{};
+    result.settle(verdict::sp, std::move(cert));
+    result.share(verdict::gsp, verdict::sp);
+    result.share(verdict::outerplanar, verdict::sp);
+    N_LOG("prefilter: " << h.e << " edges on " << h.n << " vertices\n")
+    return true;
+}
+
+// one pass over the degrees and one over the components, before the ear
+// decomposition: too many edges or no vertex of degree below 3 force a K4
+// minor, and more than one component rules out all three classes. with
+// witness set, K4 minors are left to SP_RECOGNITION, whose certificate
+// names a K4 subdivision
+template <typename idx_t>
+bool sp_prefilter(graph<idx_t> const& g, bool witness, sp_result<idx_t>& result) {
+    if (g.n < 2) return false;
+    trace_scope scope{trace_span::prefilter};
+    certificate<idx_t> cert;
+
+    if (!witness) {
+        graph_header h;
+        h.n = g.n;
+        h.e = g.e;
+        if (sp_header_prefilter(h, result)) return true;
+
+        idx_t low = g.n;
+        for (idx_t v = 0; v < g.n && low >= 3; v++) low = std::min<idx_t>(low, (idx_t)(g.adj(v).size()));
+        if (low >= 3) {
+            N_LOG("prefilter: minimum degree " << low << "\n")
+            cert = negative_cert_min_degree<idx_t>{};
+        }
+    }
+
+    if (cert.index() == 0) {
+        std::vector<bool> seen((size_t)(g.n), false);
+        std::stack<idx_t> dfs;
+        dfs.emplace(0);
+        seen[0] = true;
+        idx_t reached = 1;
+        while (!dfs.empty()) {
+            idx_t w = dfs.top();
+            dfs.pop();
+            for (idx_t u : g.adj(w)) {
+                if (!seen[u]) {
+                    seen[u] = true;
+                    reached++;
+                    dfs.emplace(u);
+                }
+            }
+        }
+        if (reached == g.n) return false;
+
+        negative_cert_disconnected<idx_t> apart{};
+        apart.a = 0;
+        apart.b = (idx_t)(std::find(seen.begin(), seen.end(), false) - seen.begin());
+        N_LOG("prefilter: " << apart.b << " not reached from 0\n")
+        cert = std::move(apart);
+    }
+
+    result = sp_result<idx_t>{};
+    result.settle(verdict::sp, std::move(cert));
+    result.share(verdict::gsp, verdict::sp);
+    result.share(verdict::outerplanar, verdict::sp);
+    return true;
+}
+
+template <typename idx_t>
+sp_result<idx_t> SP_RECOGNITION(graph<idx_t> const& g, int threads = 1, bool fused = false) {
+    sp_result<idx_t> retval{};
+
+    std::vector<idx_t> cut_verts(g.n, -1);
+    std::vector<edge_t<idx_t>> bicomps;
+    if (threads > 1) {
+        trace_scope scope{trace_span::bicomps_parallel, threads};
+        bicomps = get_bicomps_parallel(g, cut_verts, retval, threads);
+    } else {
+        trace_scope scope{trace_span::single_pass};
+        if (sp_single_pass(g, cut_verts, bicomps, retval, fused)) return retval;
+        N_LOG("GSP with a chain of bicomps, rerun as two-terminal graphs\n")
+        retval = sp_result<idx_t>{};
+    }
+
+    trace_scope scope{trace_span::chain_pass, (int64_t)(bicomps.size())};
+    idx_t n_bicomps = (idx_t)(bicomps.size());
+    sp_ear_state<idx_t> ears{g, retval, cut_verts, n_bicomps, fused};
+    std::vector<sp_vertex<idx_t>>& vert = ears.vert;
+    vertex_parents<idx_t> const& parent = ears.parent;
+    std::stack<std::pair<idx_t, neighbor_cursor<idx_t>>> dfs;
+
+    // once SP fails (its reason settled), the remaining bicomps are still run,
+    // without fake edges, to settle GSP and outerplanarity; a K4 settles all three
+    for (idx_t bicomp = 0; bicomp < n_bicomps; bicomp++) {
+        N_LOG("BICOMP " << bicomp << "\n")
+        bool op_failed_before = retval.settled(verdict::outerplanar);
+
+        idx_t root = bicomps[bicomp].first;
+        idx_t next;
+        if (!retval.settled(verdict::sp) && bicomp > 0 && bicomp < n_bicomps - 1) {
+            next = bicomps[bicomp - 1].first;
+        } else {
+            next = bicomps[bicomp].second;
+        }
+
+        dfs.emplace(root, neighbor_cursor<idx_t>{});
+        dfs.emplace(next, g.adj(next).begin());
+        trace(1, trace_kind::bicomp, (int64_t)(root), (int64_t)(next));
+
+        idx_t root_slot = g.slot_of(next, root);
+        bool fake_edge = (!retval.settled(verdict::sp) && root_slot == -1);
+        vert[root].dfs_no = 1;
+        vert[root].parent = -1;
+        vert[next].dfs_no = 2;
+        vert[next].parent = root;
+        vert[next].comp = bicomp;
+        idx_t curr_dfs = 3;
+
+        while (!dfs.empty()) {
+            idx_t w = dfs.top().first;
+            neighbor_cursor<idx_t>& at = dfs.top().second;
+            idx_t u = *at;
+            sp_vertex<idx_t>& at_u = vert[u];
+
+            if (at_u.comp == -1 || at_u.comp == bicomp) {
+                if (at_u.dfs_no == 0) {
+                    ears.enter(u, w, at.slot, curr_dfs++);
+                    at_u.comp = bicomp;
+                    dfs.emplace(u, g.adj(u).begin());
+                    continue;
+                }
+
+                if (!ears.absorb(w, u, at.slot)) break;
+            }
+
+            if ((++at).done()) {
+                if (parent[w] == root) {
+                    ears.close(w, (fake_edge ? sp_tree<idx_t>{} : sp_tree<idx_t>{root, w, root_slot}));
+                    break;
+                }
+
+                ears.finish(w);
+                dfs.pop();
+            }
+        }
+
+        vert[root].dfs_no = 0;
+
+        if (!retval.settled(verdict::outerplanar)) {
+            N_LOG("no K23 found\n")
+        }
+
+        if (fake_edge) {
+            edge_t<idx_t> fake = edge_t<idx_t>{root, next};
+
+            if (negative_cert_K4<idx_t> * k4 = std::get_if<negative_cert_K4<idx_t>>(&retval.reason(verdict::sp))) {
+                cert_path<idx_t> * k4_paths[6] = {&k4->ab, &k4->ac, &k4->ad, &k4->bc, &k4->bd, &k4->cd};
+                idx_t k4_verts[4] = {k4->a, k4->b, k4->c, k4->d};
+                static const int k4_t4_translation[6][5] = {{1, 3, 2, 4, 5}, {0, 3, 2, 5, 4}, {0, 4, 1, 5, 3}, {0, 1, 4, 5, 2}, {0, 2, 3, 5, 1}, {1, 2, 3, 4, 0}};
+                static const int k4_t4_endpoint_translation[6][4] = {{0, 1, 2, 3}, {0, 2, 1, 3}, {0, 3, 1, 2}, {1, 2, 0, 3}, {1, 3, 0, 2}, {2, 3, 0, 1}};
+
+                int pnum = 0;
+                for (; pnum < 6; pnum++) {
+                    if (k4_paths[pnum]->contains(parent, fake)) break;
+                }
+
+                if (pnum != 6) {
+                    N_LOG("FAKE EDGE IN K4 (pnum " << pnum << "), GENERATE T4\n")
+                    negative_cert_T4<idx_t> t4{};
+
+                    t4.d1a = k4_paths[k4_t4_translation[pnum][0]]->expand(parent);
+                    t4.d2a = k4_paths[k4_t4_translation[pnum][1]]->expand(parent);
+                    t4.d1b = k4_paths[k4_t4_translation[pnum][2]]->expand(parent);
+                    t4.d2b = k4_paths[k4_t4_translation[pnum][3]]->expand(parent);
+                    t4.ab = k4_paths[k4_t4_translation[pnum][4]]->expand(parent);
+                    t4.d1 = k4_verts[k4_t4_endpoint_translation[pnum][0]];
+                    t4.d2 = k4_verts[k4_t4_endpoint_translation[pnum][1]];
+                    t4.a = k4_verts[k4_t4_endpoint_translation[pnum][2]];
+                    t4.b = k4_verts[k4_t4_endpoint_translation[pnum][3]];
+
+                    // the cut vertices are the ends of the fake edge, which
+                    // need not be corners: split its path there into tails
+                    std::vector<edge_t<idx_t>> through = k4_paths[pnum]->expand(parent);
+                    if (through.front().first != t4.d1) {
+                        std::reverse(through.begin(), through.end());
+                        for (edge_t<idx_t>& e : through) std::swap(e.first, e.second);
+                    }
+                    size_t at = 0;
+                    while (through[at] != fake && through[at] != edge_t<idx_t>{next, root}) at++;
+                    t4.c1 = through[at].first;
+                    t4.c2 = through[at].second;
+                    for (size_t i = at; i-- > 0;) t4.c1d1.emplace_back(through[i].second, through[i].first);
+                    t4.c2d2.assign(through.begin() + (ptrdiff_t)(at) + 1, through.end());
+
+                    retval.settle(verdict::sp, std::move(t4));
+
+                    // a K23 found while the fake edge was in place may not
+                    // survive without it, so outerplanarity is rerun too
+                    if (!op_failed_before) retval.reason(verdict::outerplanar) = std::monostate{};
+
+                    for (idx_t i = 0; i < g.n; i++) {
+                        if (vert[i].comp == bicomp) ears.reset(i);
+                    }
+
+                    bicomp--;
+                    continue;
+                }
+            }
+
+            negative_cert_K23<idx_t> * k23 = std::get_if<negative_cert_K23<idx_t>>(&retval.reason(verdict::outerplanar));
+            if (!op_failed_before && k23) {
+                cert_path<idx_t> * k23_paths[3] = {&k23->one, &k23->two, &k23->three};
+
+                int pnum = 0;
+                for (; pnum < 3; pnum++) {
+                    if (k23_paths[pnum]->contains(parent, fake)) break;
+                }
+
+                if (pnum != 3) {
+                    N_LOG("FAKE EDGE IN K23 (" << fake.first << ", " << fake.second << "), REPLACE WITH PATH\n")
+
+                    cert_path<idx_t> splice_path;
+                    std::vector<bool> in_k23(g.n, false);
+
+                    for (cert_path<idx_t> * path : k23_paths) {
+                        path->for_each_edge(parent, [&](idx_t u, idx_t v) {
+                            in_k23[u] = true;
+                            in_k23[v] = true;
+                            V_LOG("(" << u << ", " << v << ") in K23\n")
+                        });
+                    }
+
+                    for (idx_t u2 : g.adj(next)) {
+                        if (vert[u2].comp == bicomp && parent[u2] == next && !in_k23[u2]) {
+                            V_LOG("FOUND TREE CHILD OF NEXT " << next << " NOT IN K23: " << u2 << ", ear (" << vert[u2].ear.first << ", " << vert[u2].ear.second << ")\n")
+                            splice_path.down(next, vert[u2].ear.first);
+                            splice_path.edge(vert[u2].ear.first, root);
+                            break;
+                        }
+                    }
+
+                    k23_paths[pnum]->splice(parent, fake, splice_path);
+                }
+            }
+        }
+
+        if (std::holds_alternative<negative_cert_K4<idx_t>>(retval.reason(verdict::sp))) {
+            N_LOG("K4 found, graph is not GSP\n")
+            retval.share(verdict::gsp, verdict::sp);
+            if (!retval.settled(verdict::outerplanar)) retval.share(verdict::outerplanar, verdict::sp);
+            break;
+        }
+
+        if (retval.settled(verdict::sp)) retval.is_sp = false;
+
+        if (bicomp < n_bicomps - 1) {
+            ears.hang(root, next);
+        } else if (cut_verts[root] != -1) {
+            ears.hang(root, next);
+            ears.settle(std::move(ears.cut_vertex_attached_tree[cut_verts[root]]));
+        } else {
+            ears.settle(std::move(vert[next].seq));
+        }
+    }
+
+    #ifdef __VERBOSE_LOGGING__
+        for (idx_t i = 0; i < g.n; i++) {
+            V_LOG("vertex " << i << " ear: (" << vert[i].ear.first << ", " << vert[i].ear.second << ")\n")
+            V_LOG("vertex " << i << " parent: " << parent[i] << "\n")
+            V_LOG("vertex " << i << " dfs_no: " << vert[i].dfs_no << "\n")
+        }
+    #endif
+
+    return retval;
+}
+
+// ==================== CONNECTED COMPONENTS ====================
+// a disconnected graph, recognized a component at a time. the components are
+// labelled by union-find over the edges, in parallel blocks of vertices, then
+// recognized on a pool of threads, largest first, so the long ones start
+// before the short ones fill the pool. each is relabelled as a graph of its
+// own and authenticated there, after which its graph is dropped; isolated
+// vertices are only counted
+template <typename idx_t>
+struct sp_components {
+    struct part {
+        std::vector<idx_t> verts; // of G, by local id
+        idx_t e = 0;
+        sp_result<idx_t> result; // in local ids
+        bool authenticated = false;
+    };
+
+    std::vector<part> parts; // largest first, ties by smallest vertex
+    idx_t isolated = 0;
+
+    bool all(verdict v) const {
+        for (part const& p : parts) {
+            bool yes = v == verdict::sp ? p.result.is_sp : v == verdict::gsp ? p.result.is_gsp : p.result.is_outerplanar;
+            if (!yes) return false;
+        }
+        return true;
+    }
+
+    void build(graph<idx_t> const& g, bool witness, int threads = 1, bool fused = false) {
+        trace_scope scope{trace_span::components};
+        parts.clear();
+        isolated = 0;
+        std::vector<std::atomic<idx_t>> uf((size_t)(g.n));
+        parallel_blocks<idx_t>(0, g.n, threads, [&](idx_t lo, idx_t hi) {
+            for (idx_t v = lo; v < hi; v++) uf[v].store(v, std::memory_order_relaxed);
+        });
+        parallel_blocks<idx_t>(0, g.n, threads, [&](idx_t lo, idx_t hi) {
+            for (idx_t v = lo; v < hi; v++) {
+                for (idx_t u : g.adj(v)) {
+                    if (v < u) uf_union(uf, v, u);
+                }
+            }
+        });
+
+        // the roots are the smallest vertices, so parts come out in their order
+        std::vector<idx_t> label((size_t)(g.n), -1);
+        std::vector<idx_t> where((size_t)(g.n), -1);
+        for (idx_t v = 0; v < g.n; v++) {
+            if (!g.adj(v).size()) {
+                isolated++;
+                continue;
+            }
+            idx_t r = uf_find(uf, v);
+            if (label[r] == -1) {
+                label[r] = (idx_t)(parts.size());
+                parts.emplace_back();
+            }
+            part& p = parts[label[r]];
+            where[v] = (idx_t)(p.verts.size());
+            p.verts.push_back(v);
+        }
+        std::stable_sort(parts.begin(), parts.end(), [](part const& x, part const& y) { return x.verts.size() > y.verts.size(); });
+
+        std::atomic<size_t> next{0};
+        auto work = [&]() {
+            for (size_t k; (k = next.fetch_add(1, std::memory_order_relaxed)) < parts.size(); ) {
+                part& p = parts[k];
+                trace_scope part_scope{trace_span::component, (int64_t)(p.verts.size())};
+                std::vector<edge_t<idx_t>> local;
+                for (idx_t v : p.verts) {
+                    bool twice = false; // a loop is listed twice at its vertex
+                    for (idx_t u : g.adj(v)) {
+                        if (u == v) twice = !twice;
+                        if (v < u || (u == v && twice)) local.emplace_back(where[v], where[u]);
+                    }
+                }
+                p.e = (idx_t)(local.size());
+
+                graph<idx_t> h;
+                graph_from_edges((idx_t)(p.verts.size()), local, h);
+                local = std::vector<edge_t<idx_t>>{};
+                if (!sp_prefilter(h, witness, p.result)) p.result = SP_RECOGNITION(h, 1, fused);
+                try {
+                    p.authenticated = p.result.settled(verdict::sp) && p.result.authenticate(h);
+                } catch (...) {
+                    p.authenticated = false;
+                }
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int t = 1; t < threads && (size_t)(t) < parts.size(); t++) pool.emplace_back(work);
+        work();
+        for (std::thread& th : pool) th.join();
+    }
+};
+
+// ==================== DYNAMIC PROGRAMMING OVER SP TREES ====================
+// a problem is solved bottom-up over a GSP decomposition tree by combining
+// values of two-terminal subgraphs. a value describes its subgraph with respect
+// to its source and sink; antiparallel nodes are taken care of by the traversal,
+// which reads reversed subtrees with source and sink swapped, so every
+// operator sees its children in the orientation of the parent
+template <typename T, typename idx_t>
+struct sp_dp_ops {
+    // the edge source -> sink of weight w
+    std::function<T(idx_t source, idx_t sink, double w)> edge;
+    // l spans source -> mid, r spans mid -> sink; mid becomes internal
+    std::function<T(T const& l, T const& r, idx_t mid)> series;
+    // l and r both span source -> sink
+    std::function<T(T const& l, T const& r)> parallel;
+    // h hangs off main's source (at_source) or sink. h's source is that
+    // vertex and its sink, free_end, becomes internal
+    std::function<T(T const& main, T const& h, bool at_source, idx_t free_end)> dangling;
+};
+
+// one node of the tree in post-order, with the orientation it is read in
+template <typename idx_t>
+struct sp_dp_step {
+    sp_tree_node<idx_t> * node;
+    bool swap;
+    idx_t size; // nodes in the subtree rooted here
+};
+
+// the k-th child (0 or 1) of a node, in the order and orientation the
+// operators expect: the series children from source to sink, the reversed
+// half of an antiparallel node flipped back, and a dangling subtree read from
+// the vertex it hangs off
+template <typename idx_t>
+sp_dp_step<idx_t> sp_dp_child(sp_tree_node<idx_t> * curr, bool swap, int k) {
+    switch (curr->comp) {
+        case c_type::series:
+            return sp_dp_step<idx_t>{(k == 0) != swap ? curr->l : curr->r, swap, 0};
+        case c_type::antiparallel:
+            return (k == 0 ? sp_dp_step<idx_t>{curr->l, swap, 0} : sp_dp_step<idx_t>{curr->r, !swap, 0});
+        case c_type::dangling:
+            return (k == 0 ? sp_dp_step<idx_t>{curr->l, swap, 0} : sp_dp_step<idx_t>{curr->r, false, 0});
+        case c_type::parallel:
+        case c_type::edge:
+            break;
+    }
+    return sp_dp_step<idx_t>{k == 0 ? curr->l : curr->r, swap, 0};
+}
+
+template <typename idx_t>
+std::vector<sp_dp_step<idx_t>> sp_dp_order(sp_tree<idx_t> const& t) {
+    std::vector<sp_dp_step<idx_t>> order;
+    sp_tree_walk(t.root, false, [](sp_tree_node<idx_t> * curr, bool swap) {
+        if (curr->comp == c_type::edge) return sp_walk_children<idx_t>{};
+        sp_dp_step<idx_t> l = sp_dp_child(curr, swap, 0);
+        sp_dp_step<idx_t> r = sp_dp_child(curr, swap, 1);
+        return sp_walk_children<idx_t>{l.node, l.swap, r.node, r.swap};
+    }, [&](sp_tree_node<idx_t> * curr, sp_visit phase, bool swap) {
+        if (phase != sp_visit::post) return true;
+        idx_t size = 1;
+        if (curr->comp != c_type::edge) {
+            idx_t r_size = order.back().size;
+            size = 1 + r_size + order[order.size() - 1 - r_size].size;
+        }
+        order.push_back(sp_dp_step<idx_t>{curr, swap, size});
+        return true;
+    });
+    return order;
+}
+
+// evaluates order[lo..hi] bottom-up, where whole subtrees already evaluated
+// are skipped through jump (first index of the subtree -> its root)
+template <typename T, typename idx_t>
+T sp_dp_eval(std::vector<sp_dp_step<idx_t>> const& order, idx_t lo, idx_t hi, graph<idx_t> const& g, sp_dp_ops<T, idx_t> const& ops,
+             std::vector<idx_t> const& jump, std::vector<std::optional<T>>& done) {
+    std::vector<T> vals;
+
+    for (idx_t i = lo; i <= hi; i++) {
+        if (!jump.empty() && jump[i] != -1 && jump[i] <= hi) {
+            i = jump[i];
+            vals.push_back(std::move(*(done[i])));
+            continue;
+        }
+
+        sp_tree_node<idx_t> * curr = order[i].node;
+        bool swap = order[i].swap;
+
+        if (curr->comp == c_type::edge) {
+            vals.push_back(ops.edge(swap ? curr->sink : curr->source, swap ? curr->source : curr->sink, g.weight(curr->sink, curr->slot)));
+            continue;
+        }
+
+        T r = std::move(vals.back());
+        vals.pop_back();
+        T l = std::move(vals.back());
+        vals.pop_back();
+
+        switch (curr->comp) {
+            case c_type::series:
+                vals.push_back(ops.series(l, r, swap ? curr->r->source : curr->l->sink));
+                break;
+            case c_type::parallel:
+            case c_type::antiparallel:
+                vals.push_back(ops.parallel(l, r));
+                break;
+            case c_type::dangling:
+                vals.push_back(ops.dangling(l, r, !swap, curr->r->sink));
+                break;
+            case c_type::edge:
+                break;
+        }
+    }
+
+    return std::move(vals.back());
+}
+
+// runs a dp over the decomposition tree t of g. with threads > 1, disjoint
+// subtrees of at most about 1/(8 * threads) of the tree are evaluated
+// concurrently first, then the part of the tree above them
+template <typename T, typename idx_t>
+T sp_tree_dp(sp_tree<idx_t> const& t, graph<idx_t> const& g, sp_dp_ops<T, idx_t> const& ops, int threads = 1) {
+    std::vector<sp_dp_step<idx_t>> order = sp_dp_order(t);
+    idx_t n_steps = (idx_t)(order.size());
+    std::vector<idx_t> jump;
+    std::vector<std::optional<T>> done;
+
+    if (threads > 1 && n_steps > 1) {
+        idx_t grain = std::max<idx_t>(n_steps / (8 * threads), 1024);
+        std::vector<idx_t> tasks;
+        for (idx_t i = n_steps - 1; i >= 0;) {
+            if (order[i].size <= grain) {
+                tasks.push_back(i);
+                i -= order[i].size;
+            } else {
+                i--;
+            }
+        }
+
+        if (tasks.size() > 1) {
+            jump.assign((size_t)(n_steps), -1);
+            done.resize((size_t)(n_steps));
+            for (idx_t root : tasks) jump[root - order[root].size + 1] = root;
+
+            std::atomic<size_t> next_task{0};
+            std::exception_ptr failure;
+            std::atomic<bool> failed{false};
+            std::vector<std::thread> pool;
+            std::vector<idx_t> no_jump;
+
+            for (idx_t i = 0; i < threads; i++) {
+                pool.emplace_back([&]() {
+                    for (size_t k = next_task++; k < tasks.size(); k = next_task++) {
+                        idx_t root = tasks[k];
+                        try {
+                            done[root] = sp_dp_eval(order, root - order[root].size + 1, root, g, ops, no_jump, done);
+                        } catch (...) {
+                            if (!failed.exchange(true)) failure = std::current_exception();
+                        }
+                    }
+                });
+            }
+
+            for (std::thread& th : pool) th.join();
+            if (failure) std::rethrow_exception(failure);
+            N_LOG("dp: " << tasks.size() << " subtrees evaluated on " << threads << " threads\n")
+        }
+    }
+
+    return sp_dp_eval(order, (idx_t)(0), n_steps - 1, g, ops, jump, done);
+}
+
+// maximum weight of an independent set; vertex_weight may be empty (all 1)
+template <typename idx_t>
+double sp_max_weight_independent_set(sp_tree<idx_t> const& t, graph<idx_t> const& g, std::vector<double> const& vertex_weight, int threads = 1) {
+    // best[2 * s + t]: best weight with source (s) and sink (t) in or out of
+    // the set, not counting the terminals' own weights
+    using state = std::array<double, 4>;
+    static const double none = -std::numeric_limits<double>::infinity();
+    auto weight = [&](idx_t v) { return vertex_weight.empty() ? 1.0 : vertex_weight[v]; };
+
+    sp_dp_ops<state, idx_t> ops;
+    ops.edge = [](idx_t, idx_t, double) { return state{0, 0, 0, none}; };
+    ops.series = [&](state const& l, state const& r, idx_t mid) {
+        state res;
+        for (int s = 0; s < 2; s++) {
+            for (int k = 0; k < 2; k++) {
+                res[2 * s + k] = std::max(l[2 * s] + r[k], l[2 * s + 1] + r[2 + k] + weight(mid));
+            }
+        }
+        return res;
+    };
+    ops.parallel = [](state const& l, state const& r) {
+        return state{l[0] + r[0], l[1] + r[1], l[2] + r[2], l[3] + r[3]};
+    };
+    ops.dangling = [&](state const& main, state const& h, bool at_source, idx_t free_end) {
+        double h_out = std::max(h[0], h[1] + weight(free_end));
+        double h_in = std::max(h[2], h[3] + weight(free_end));
+        state res;
+        for (int i = 0; i < 4; i++) res[i] = main[i] + (((at_source ? i >> 1 : i & 1) != 0) ? h_in : h_out);
+        return res;
+    };
+
+    state root = sp_tree_dp(t, g, ops, threads);
+    double best = none;
+    for (int i = 0; i < 4; i++) {
+        best = std::max(best, root[i] + ((i >> 1) ? weight(t.root->source) : 0) + ((i & 1) ? weight(t.root->sink) : 0));
+    }
+    return best;
+}
+
+// a real number as mantissa * 2^exp, with the mantissa in [0.5, 1) or 0, so
+// that products over a whole graph neither overflow nor underflow a double
+struct scaled_real {
+    double mantissa = 0;
+    int64_t exp = 0;
+
+    scaled_real() = default;
+    scaled_real(double x) {
+        int e = 0;
+        mantissa = std::frexp(x, &e);
+        exp = e;
+    }
+
+    static scaled_real normal(double m, int64_t e) {
+        scaled_real r{m};
+        if (r.mantissa != 0) r.exp += e;
+        return r;
+    }
+
+    scaled_real operator*(scaled_real const& o) const {
+        return normal(mantissa * o.mantissa, exp + o.exp);
+    }
+
+    scaled_real operator+(scaled_real const& o) const {
+        if (o.mantissa == 0) return *this;
+        if (mantissa == 0) return o;
+        scaled_real const& hi = (exp >= o.exp ? *this : o);
+        scaled_real const& lo = (exp >= o.exp ? o : *this);
+        if (hi.exp - lo.exp > 64) return hi; // lo is below hi's last bit
+        return normal(hi.mantissa + std::ldexp(lo.mantissa, (int)(lo.exp - hi.exp)), hi.exp);
+    }
+
+    // 10-based, with digits significant digits, e.g. 1.234e+5678
+    void print(std::ostream& out, int digits) const {
+        std::ostringstream os;
+        if (exp > -1000 && exp < 1000) {
+            os << std::setprecision(digits) << std::ldexp(mantissa, (int)(exp));
+        } else {
+            double lg = std::log10(std::fabs(mantissa)) + (double)(exp) * std::log10(2.0);
+            int64_t e10 = (int64_t)(std::floor(lg));
+            double lead = std::pow(10.0, lg - (double)(e10));
+            if (lead >= 10 - 5 * std::pow(10.0, 1 - digits)) {
+                lead /= 10;
+                e10++;
+            }
+            os << (mantissa < 0 ? "-" : "") << std::fixed << std::setprecision(digits - 1) << lead << "e" << (e10 < 0 ? "-" : "+") << std::llabs(e10);
+        }
+        out << os.str();
+    }
+};
+
+// arithmetic modulo the Mersenne prime 2^61 - 1
+struct mod_mersenne61 {
+    static constexpr uint64_t p = ((uint64_t)(1) << 61) - 1;
+    uint64_t v = 0;
+
+    mod_mersenne61() = default;
+    mod_mersenne61(uint64_t x) : v(x % p) {}
+
+    mod_mersenne61 operator*(mod_mersenne61 const& o) const {
+        unsigned __int128 x = (unsigned __int128)(v) * o.v;
+        uint64_t r = (uint64_t)(x & p) + (uint64_t)(x >> 61);
+        return mod_mersenne61{r >= p ? r - p : r};
+    }
+
+    mod_mersenne61 operator+(mod_mersenne61 const& o) const {
+        uint64_t r = v + o.v;
+        return mod_mersenne61{r >= p ? r - p : r};
+    }
+};
+
+// number of spanning trees, each counted with the product of its edge
+// weights (the plain count on unweighted graphs), in the arithmetic of T:
+// scaled_real for the magnitude, mod_mersenne61 for an unweighted count
+template <typename T, typename idx_t>
+T sp_spanning_tree_count(sp_tree<idx_t> const& t, graph<idx_t> const& g, int threads = 1) {
+    // first: spanning trees, second: spanning forests of two trees, one
+    // holding the source and the other the sink
+    using state = std::pair<T, T>;
+
+    sp_dp_ops<state, idx_t> ops;
+    ops.edge = [](idx_t, idx_t, double w) { return state{T(w), T(1.0)}; };
+    ops.series = [](state const& l, state const& r, idx_t) {
+        return state{l.first * r.first, l.first * r.second + l.second * r.first};
+    };
+    ops.parallel = [](state const& l, state const& r) {
+        return state{l.first * r.second + l.second * r.first, l.second * r.second};
+    };
+    ops.dangling = [](state const& main, state const& h, bool, idx_t) {
+        return state{main.first * h.first, main.second * h.first};
+    };
+
+    return sp_tree_dp(t, g, ops, threads).first;
+}
+
+// the count as reported: exact on an unweighted graph while it is below
+// 2^59, where the count modulo 2^61 - 1 is the count itself. past that,
+// the leading digits and the exact count modulo 2^61 - 1. a weighted count
+// is floating point, so its digits are marked approximate
+template <typename idx_t>
+void print_spanning_tree_count(sp_tree<idx_t> const& t, graph<idx_t> const& g, int threads, std::ostream& out) {
+    scaled_real approx = sp_spanning_tree_count<scaled_real>(t, g, threads);
+    if (g.weights()) {
+        out << "about ";
+        approx.print(out, 12);
+        return;
+    }
+    mod_mersenne61 exact = sp_spanning_tree_count<mod_mersenne61>(t, g, threads);
+    if (approx.exp < 60) { // below 2^59, rounding error and all
+        out << exact.v;
+        return;
+    }
+    out << "about ";
+    approx.print(out, 12);
+    out << ", " << exact.v << " modulo 2^61 - 1";
+}
+
+// ==================== DISTANCE ORACLE ====================
+// shortest-path distances in a weighted GSP graph, indexed once from its
+// decomposition tree. every internal node stores the distances in G between
+// its terminals and its middle vertex (the series middle, or the free end of
+// a dangling subtree). a vertex becomes internal at exactly one node, its
+// home, and its distances to the terminals of any ancestor of home follow by
+// min-plus products of 2x2 matrices up the tree; a query meets at the lowest
+// common ancestor of the two homes. jump pointers (Myers' skew-binary scheme)
+// cover any climb in O(log n) steps
+template <typename idx_t>
+struct sp_oracle_node {
+    idx_t parent;
+    idx_t jump;
+    idx_t depth;
+    idx_t source;
+    idx_t sink;
+    idx_t mid; // series middle vertex, dangling free end, or -1
+    double st; // distance in G between source and sink
+    double sm; // distance in G between source and mid
+    double mt; // distance in G between mid and sink
+    double jump_dist[2][2]; // from {source, sink} to jump's {source, sink}
+};
+
+// on-disk layout: this header, the nodes, then home. everything is in native
+// byte order so that a saved oracle is queried in place through mmap
+struct sp_oracle_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t index_bytes; // sizeof(idx_t) of the writer
+    int64_t n;
+    int64_t n_nodes;
+};
+
+static const char sp_oracle_magic[8] = {'S', 'P', 'O', 'R', 'A', 'C', 'L', 'E'};
+
+template <typename idx_t>
+struct sp_distance_oracle {
+    static constexpr double inf = std::numeric_limits<double>::infinity();
+
+    idx_t n = 0;
+    idx_t n_nodes = 0;
+    sp_oracle_node<idx_t> const * nodes = nullptr; // preorder, root first
+    idx_t const * home = nullptr; // node at which each vertex becomes internal
+
+    std::vector<sp_oracle_node<idx_t>> node_store; // backing storage when built here
+    std::vector<idx_t> home_store;
+    void * mapping = nullptr; // backing storage when mapped from a file
+    size_t mapping_size = 0;
+
+    sp_distance_oracle() = default;
+    sp_distance_oracle(sp_distance_oracle<idx_t> const& other) = delete;
+    sp_distance_oracle<idx_t>& operator=(sp_distance_oracle<idx_t> const& other) = delete;
+
+    ~sp_distance_oracle() {
+        release();
+    }
+
+    void release() {
+        if (mapping) munmap(mapping, mapping_size);
+        mapping = nullptr;
+        mapping_size = 0;
+        node_store.clear();
+        home_store.clear();
+        nodes = nullptr;
+        home = nullptr;
+        n = n_nodes = 0;
+    }
+
+    // distance in G between two of node x's source, sink and mid
+    double local(idx_t x, idx_t a, idx_t b) const {
+        sp_oracle_node<idx_t> const& nd = nodes[x];
+        if (a == -1 || b == -1) return inf;
+        if (a == b) return 0.0;
+        if ((a == nd.source && b == nd.sink) || (a == nd.sink && b == nd.source)) return nd.st;
+        if ((a == nd.source && b == nd.mid) || (a == nd.mid && b == nd.source)) return nd.sm;
+        if ((a == nd.mid && b == nd.sink) || (a == nd.sink && b == nd.mid)) return nd.mt;
+        return inf;
+    }
+
+    // distances from node x's terminals to those of its parent
+    void to_parent(idx_t x, double out[2][2]) const {
+        sp_oracle_node<idx_t> const& nd = nodes[x];
+        sp_oracle_node<idx_t> const& pn = nodes[nd.parent];
+        out[0][0] = local(nd.parent, nd.source, pn.source);
+        out[0][1] = local(nd.parent, nd.source, pn.sink);
+        out[1][0] = local(nd.parent, nd.sink, pn.source);
+        out[1][1] = local(nd.parent, nd.sink, pn.sink);
+    }
+
+    static void min_plus(double const a[2][2], double const b[2][2], double out[2][2]) {
+        for (int i = 0; i < 2; i++) {
+            for (int j = 0; j < 2; j++) out[i][j] = std::min(a[i][0] + b[0][j], a[i][1] + b[1][j]);
+        }
+    }
+
+    static void min_plus(double vec[2], double const m[2][2]) {
+        double v0 = std::min(vec[0] + m[0][0], vec[1] + m[1][0]);
+        double v1 = std::min(vec[0] + m[0][1], vec[1] + m[1][1]);
+        vec[0] = v0;
+        vec[1] = v1;
+    }
+
+    void build(sp_tree<idx_t> const& t, graph<idx_t> const& g) {
+        release();
+        n = g.n;
+        home_store.assign((size_t)(n), -1);
+        home = home_store.data();
+        if (!t.root) return;
+
+        // internal nodes in preorder (a lone edge is kept as the root), with
+        // the indices of their children, or -1 for edge leaves
+        std::vector<sp_tree_node<idx_t> *> tree;
+        std::vector<idx_t> parent;
+        std::vector<idx_t> child[2];
+        idx_t at = -1; // the innermost node entered
+        int side = 0; // the child of it being walked
+
+        sp_tree_walk(t.root, [&](sp_tree_node<idx_t> * curr, sp_visit phase) {
+            if (curr->comp == c_type::edge && curr != t.root) return true;
+            if (phase == sp_visit::pre) {
+                idx_t idx = (idx_t)(tree.size());
+                tree.push_back(curr);
+                parent.push_back(at);
+                child[0].push_back(-1);
+                child[1].push_back(-1);
+                if (at >= 0) child[side][at] = idx;
+                at = idx;
+                side = 0;
+            } else if (phase == sp_visit::in) {
+                side = 1;
+            } else {
+                at = parent[at];
+            }
+            return true;
+        });
+
+        n_nodes = (idx_t)(tree.size());
+
+        // inside: distance between the terminals within the node's subgraph
+        std::vector<double> inside((size_t)(n_nodes));
+        auto inner = [&](idx_t i, int k) {
+            sp_tree_node<idx_t> * c = (k == 0 ? tree[i]->l : tree[i]->r);
+            return (child[k][i] == -1 ? g.weight(c->sink, c->slot) : inside[child[k][i]]);
+        };
+
+        for (idx_t i = n_nodes - 1; i >= 0; i--) {
+            switch (tree[i]->comp) {
+                case c_type::edge:
+                    inside[i] = g.weight(tree[i]->sink, tree[i]->slot);
+                    break;
+                case c_type::series:
+                    inside[i] = inner(i, 0) + inner(i, 1);
+                    break;
+                case c_type::parallel:
+                case c_type::antiparallel:
+                    inside[i] = std::min(inner(i, 0), inner(i, 1));
+                    break;
+                case c_type::dangling:
+                    inside[i] = inner(i, 0);
+                    break;
+            }
+        }
+
+        // outside: distance between the terminals through the rest of G. the
+        // terminals are the only way in or out of a node's subgraph, so the
+        // distance in G is the smaller of the two
+        std::vector<double> outside((size_t)(n_nodes), inf);
+        node_store.resize((size_t)(n_nodes));
+        nodes = node_store.data();
+
+        for (idx_t i = 0; i < n_nodes; i++) {
+            sp_tree_node<idx_t> * curr = tree[i];
+            sp_oracle_node<idx_t>& nd = node_store[i];
+            nd.parent = parent[i];
+            nd.source = curr->source;
+            nd.sink = curr->sink;
+            nd.mid = -1;
+            nd.st = std::min(inside[i], outside[i]);
+            nd.sm = inf;
+            nd.mt = inf;
+
+            if (curr->comp != c_type::edge) {
+                double dl = inner(i, 0);
+                double dr = inner(i, 1);
+                double out_l = outside[i];
+                double out_r = outside[i];
+
+                switch (curr->comp) {
+                    case c_type::series:
+                        out_l = outside[i] + dr;
+                        out_r = outside[i] + dl;
+                        nd.mid = curr->l->sink;
+                        nd.sm = std::min(dl, out_l);
+                        nd.mt = std::min(dr, out_r);
+                        break;
+                    case c_type::parallel:
+                    case c_type::antiparallel:
+                        out_l = std::min(outside[i], dr);
+                        out_r = std::min(outside[i], dl);
+                        break;
+                    case c_type::dangling:
+                        // r hangs at the source; its sink is reachable only through it
+                        out_r = inf;
+                        nd.mid = curr->r->sink;
+                        nd.sm = dr;
+                        nd.mt = dr + nd.st;
+                        break;
+                    case c_type::edge:
+                        break;
+                }
+
+                if (child[0][i] != -1) outside[child[0][i]] = out_l;
+                if (child[1][i] != -1) outside[child[1][i]] = out_r;
+                if (nd.mid != -1) home_store[nd.mid] = i;
+            }
+
+            if (i == 0) {
+                nd.jump = 0;
+                nd.depth = 0;
+                nd.jump_dist[0][0] = nd.jump_dist[1][1] = 0.0;
+                nd.jump_dist[0][1] = nd.jump_dist[1][0] = nd.st;
+                continue;
+            }
+
+            sp_oracle_node<idx_t> const& pn = node_store[nd.parent];
+            sp_oracle_node<idx_t> const& jp = node_store[pn.jump];
+            double up[2][2];
+            to_parent(i, up);
+            nd.depth = pn.depth + 1;
+
+            if (pn.depth - jp.depth == jp.depth - node_store[jp.jump].depth) {
+                double half[2][2];
+                min_plus(up, pn.jump_dist, half);
+                min_plus(half, jp.jump_dist, nd.jump_dist);
+                nd.jump = jp.jump;
+            } else {
+                std::memcpy(nd.jump_dist, up, sizeof(up));
+                nd.jump = nd.parent;
+            }
+        }
+
+        home_store[node_store[0].source] = 0;
+        home_store[node_store[0].sink] = 0;
+        N_LOG("distance oracle: " << n_nodes << " nodes\n")
+    }
+
+    // ancestor of x at the given depth
+    idx_t ancestor(idx_t x, idx_t depth) const {
+        while (nodes[x].depth > depth) {
+            x = (nodes[nodes[x].jump].depth >= depth ? nodes[x].jump : nodes[x].parent);
+        }
+        return x;
+    }
+
+    idx_t lca(idx_t x, idx_t y) const {
+        idx_t depth = std::min(nodes[x].depth, nodes[y].depth);
+        x = ancestor(x, depth);
+        y = ancestor(y, depth);
+        while (x != y) {
+            if (nodes[x].jump != nodes[y].jump) {
+                x = nodes[x].jump;
+                y = nodes[y].jump;
+            } else {
+                x = nodes[x].parent;
+                y = nodes[y].parent;
+            }
+        }
+        return x;
+    }
+
+    // distances in G from u to the source, sink and mid of z, an ancestor of
+    // home[u] (or home[u] itself)
+    std::array<double, 3> lift(idx_t u, idx_t z) const {
+        idx_t x = home[u];
+        sp_oracle_node<idx_t> const& zn = nodes[z];
+        if (x == z) return {local(z, u, zn.source), local(z, u, zn.sink), local(z, u, zn.mid)};
+
+        double vec[2] = {local(x, u, nodes[x].source), local(x, u, nodes[x].sink)};
+        idx_t depth = zn.depth + 1;
+        while (nodes[x].depth > depth) {
+            if (nodes[nodes[x].jump].depth >= depth) {
+                min_plus(vec, nodes[x].jump_dist);
+                x = nodes[x].jump;
+            } else {
+                double up[2][2];
+                to_parent(x, up);
+                min_plus(vec, up);
+                x = nodes[x].parent;
+            }
+        }
+
+        // x is now the child of z on the way up; its terminals are among z's
+        std::array<double, 3> res;
+        idx_t targets[3] = {zn.source, zn.sink, zn.mid};
+        for (int k = 0; k < 3; k++) {
+            res[k] = std::min(vec[0] + local(z, nodes[x].source, targets[k]),
+                              vec[1] + local(z, nodes[x].sink, targets[k]));
+        }
+        return res;
+    }
+
+    // shortest-path distance between u and v, inf if either is unknown
+    double distance(idx_t u, idx_t v) const {
+        if (u < 0 || v < 0 || u >= n || v >= n) return inf;
+        if (u == v) return 0.0;
+        if (home[u] == -1 || home[v] == -1) return inf;
+
+        idx_t z = lca(home[u], home[v]);
+        std::array<double, 3> du = lift(u, z);
+        std::array<double, 3> dv = lift(v, z);
+        return std::min({du[0] + dv[0], du[1] + dv[1], du[2] + dv[2]});
+    }
+
+    // answers queries in order, split into contiguous blocks across threads
+    std::vector<double> distances(std::vector<edge_t<idx_t>> const& queries, int threads = 1) const {
+        std::vector<double> res(queries.size());
+        size_t block = (queries.size() + threads - 1) / std::max(threads, 1);
+        auto run = [&](size_t lo, size_t hi) {
+            for (size_t i = lo; i < hi; i++) res[i] = distance(queries[i].first, queries[i].second);
+        };
+
+        if (threads <= 1 || queries.size() < 4096) {
+            run(0, queries.size());
+            return res;
+        }
+
+        std::vector<std::thread> pool;
+        for (size_t lo = 0; lo < queries.size(); lo += block) {
+            pool.emplace_back(run, lo, std::min(lo + block, queries.size()));
+        }
+        for (std::thread& th : pool) th.join();
+        return res;
+    }
+
+    bool save(std::string const& path) const {
+        std::ofstream os(path, std::ios::binary);
+        if (!os) return false;
+
+        sp_oracle_header header{};
+        std::memcpy(header.magic, sp_oracle_magic, sizeof(header.magic));
+        header.version = 1;
+        header.index_bytes = sizeof(idx_t);
+        header.n = n;
+        header.n_nodes = n_nodes;
+        os.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        os.write(reinterpret_cast<const char*>(nodes), (std::streamsize)(sizeof(sp_oracle_node<idx_t>) * n_nodes));
+        os.write(reinterpret_cast<const char*>(home), (std::streamsize)(sizeof(idx_t) * n));
+        return (bool)(os);
+    }
+
+    // maps a saved oracle read-only; its pages are shared between processes
+    bool map(std::string const& path) {
+        release();
+        idx_t fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)(st.st_size) < sizeof(sp_oracle_header)) {
+            close(fd);
+            return false;
+        }
+
+        void * addr = mmap(nullptr, (size_t)(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED) return false;
+        mapping = addr;
+        mapping_size = (size_t)(st.st_size);
+
+        sp_oracle_header const * header = static_cast<sp_oracle_header const *>(addr);
+        size_t expected = sizeof(sp_oracle_header) + sizeof(sp_oracle_node<idx_t>) * (size_t)(header->n_nodes)
+                        + sizeof(idx_t) * (size_t)(header->n);
+        if (std::memcmp(header->magic, sp_oracle_magic, sizeof(header->magic)) != 0 || header->version != 1
+            || header->index_bytes != sizeof(idx_t) || header->n < 0 || header->n_nodes < 0 || expected != mapping_size) {
+            release();
+            return false;
+        }
+
+        n = (idx_t)(header->n);
+        n_nodes = (idx_t)(header->n_nodes);
+        nodes = reinterpret_cast<sp_oracle_node<idx_t> const *>(header + 1);
+        home = reinterpret_cast<idx_t const *>(nodes + n_nodes);
+        return true;
+    }
+};
+
+// ==================== TWO-TERMINAL QUERIES ====================
+// whether G is two-terminal series-parallel between s and t, i.e. whether
+// G + st is biconnected and free of K4 subdivisions, for any pair, read off
+// the SP decomposition tree found once by recognition (no pair works unless
+// G is SP).
+// the series compositions at the top of the tree, if the root is one, join
+// the blocks of G at its cut vertices, so s and t must lie in the first and
+// the last block, off the cut vertices. within one block, a pair works if
+// the block plus st has no K4, which holds iff both lie on one skeleton of
+// its SPQR tree: the cycle through one maximal chain of series nodes (its
+// terminals and middles, in order), or the terminals of a parallel node,
+// which are the terminals of the root or consecutive on a chain. a vertex is
+// the middle of at most one chain, so a query takes O(1)
+template <typename idx_t>
+struct sp_terminal_pairs {
+    idx_t n = 0;
+    edge_t<idx_t> root{-1, -1}; // terminals of the tree
+    std::vector<idx_t> chain; // per vertex: the chain it is a middle of, or -1
+    std::vector<idx_t> pos; // per vertex: its place on that chain, from 1
+    std::vector<edge_t<idx_t>> ends; // per chain: its terminals, at 0 and length
+    std::vector<idx_t> length; // per chain
+    std::vector<idx_t> cuts; // cut vertices, in order from root.first to root.second
+    std::vector<idx_t> block; // per vertex: its block counting from root.first, -1 on a cut vertex
+
+    void build(sp_result<idx_t> const& result, idx_t n_) {
+        n = n_;
+        chain.assign((size_t)(n), -1);
+        pos.assign((size_t)(n), 0);
+        block.assign((size_t)(n), -1);
+        ends.clear();
+        length.clear();
+        cuts.clear();
+        if (!result.is_sp || !result.decomposition()) return;
+        sp_tree<idx_t> const& t = *result.decomposition();
+        root = edge_t<idx_t>{t.root->source, t.root->sink};
+
+        // chain of every internal node entered, -1 off series nodes. chain 0,
+        // if the root is a series node, is the one joining the blocks
+        bool blocks = (t.root->comp == c_type::series);
+        std::vector<idx_t> context;
+        sp_tree_node<idx_t> * part = nullptr; // the block being walked
+        idx_t parts = 0;
+
+        sp_tree_walk(t.root, [&](sp_tree_node<idx_t> * curr, sp_visit phase) {
+            idx_t outer = (context.empty() ? -1 : context.back());
+            if (phase == sp_visit::pre) {
+                if (blocks && outer == 0 && curr->comp != c_type::series && !part) {
+                    part = curr;
+                    parts++;
+                }
+                if (curr->comp == c_type::edge) {
+                    for (idx_t v : {curr->source, curr->sink}) {
+                        if (part && chain[v] != 0) block[v] = parts - 1;
+                    }
+                } else if (curr->comp == c_type::series) {
+                    idx_t id = outer;
+                    if (id == -1) {
+                        id = (idx_t)(ends.size());
+                        ends.emplace_back(curr->source, curr->sink);
+                        length.push_back(1);
+                    }
+                    chain[curr->l->sink] = id;
+                    context.push_back(id);
+                } else {
+                    context.push_back(-1);
+                }
+            } else if (phase == sp_visit::in) {
+                if (curr->comp == c_type::series) pos[curr->l->sink] = length[outer]++;
+                if (blocks && outer == 0 && curr->comp == c_type::series) cuts.push_back(curr->l->sink);
+            } else {
+                if (curr->comp != c_type::edge) context.pop_back();
+                if (curr == part) part = nullptr;
+            }
+            return true;
+        });
+    }
+
+    bool on(idx_t v, idx_t c) const {
+        return chain[v] == c || ends[c].first == v || ends[c].second == v;
+    }
+
+    // place of v, on chain c, around the chain's cycle
+    idx_t place(idx_t v, idx_t c) const {
+        return (chain[v] == c ? pos[v] : (v == ends[c].first ? 0 : length[c]));
+    }
+
+    // a chain through both s and t, or -1
+    idx_t common_chain(idx_t s, idx_t t) const {
+        if (chain[s] != -1 && on(t, chain[s])) return chain[s];
+        if (chain[t] != -1 && on(s, chain[t])) return chain[t];
+        return -1;
+    }
+
+    // the block containing s and t, with st, has no K4
+    bool share(idx_t s, idx_t t) const {
+        if ((s == root.first && t == root.second) || (s == root.second && t == root.first)) return true;
+        return common_chain(s, t) != -1;
+    }
+
+    // share(a, b) once the edge xy, with share(x, y), is added to a block:
+    // the skeletons stay the same, but for a chain on which x and y are not
+    // neighbours, whose cycle the chord splits in two
+    bool share_after(idx_t x, idx_t y, idx_t a, idx_t b) const {
+        idx_t c = common_chain(x, y);
+        if (c != -1 && on(a, c) && on(b, c)) {
+            idx_t px = place(x, c), py = place(y, c);
+            if (px > py) std::swap(px, py);
+            if (py - px > 1 && !(px == 0 && py == length[c])) {
+                auto inside = [&](idx_t v) {
+                    idx_t p = place(v, c);
+                    return px <= p && p <= py;
+                };
+                auto outside = [&](idx_t v) {
+                    idx_t p = place(v, c);
+                    return p <= px || py <= p;
+                };
+                return (inside(a) && inside(b)) || (outside(a) && outside(b));
+            }
+        }
+        return share(a, b);
+    }
+
+    bool two_terminal(idx_t s, idx_t t) const {
+        if (s == t || s < 0 || t < 0 || s >= n || t >= n || root.first == -1) return false;
+        if (cuts.empty()) return share(s, t);
+        if (block[s] == -1 || block[t] == -1) return false;
+        if (block[s] > block[t]) std::swap(s, t);
+        return block[s] == 0 && block[t] == (idx_t)(cuts.size()) && share(s, cuts.front()) && share(cuts.back(), t);
+    }
+
+    std::vector<char> two_terminal(std::vector<edge_t<idx_t>> const& queries, int threads = 1) const {
+        std::vector<char> res(queries.size());
+        parallel_blocks<int64_t>(0, (int64_t)(queries.size()), threads, [&](int64_t lo, int64_t hi) {
+            for (int64_t i = lo; i < hi; i++) res[i] = two_terminal(queries[i].first, queries[i].second);
+        });
+        return res;
+    }
+};
+
+// ==================== EDGE INSERTION QUERIES ====================
+// the blocks of g by low points, one dfs per component, with a stack of
+// the vertices not yet closed. a block is closed below the vertex it hangs
+// from, its head, which has local id 0; every other vertex is closed in
+// exactly one block, its home. an edge belongs to the home of its endpoint
+// found later
+template <typename idx_t>
+struct graph_blocks {
+    std::vector<idx_t> dfs_no; // per vertex, 0 if isolated
+    std::vector<idx_t> home; // per vertex: the block it is closed in, -1 for roots and isolated ones
+    std::vector<idx_t> local; // per vertex: its id within home
+    std::vector<idx_t> head; // per block
+    std::vector<idx_t> sizes; // per block: its vertices
+    std::vector<idx_t> roots; // one per component with an edge
+
+    idx_t count() const {return (idx_t)(head.size());}
+
+    // id of v within block b, which must contain it
+    idx_t id(idx_t v, idx_t b) const {
+        return (home[v] == b ? local[v] : 0);
+    }
+
+    idx_t block_of(idx_t v, idx_t w) const {
+        return home[dfs_no[v] > dfs_no[w] ? v : w];
+    }
+
+    void build(graph<idx_t> const& g) {
+        dfs_no.assign((size_t)(g.n), 0);
+        home.assign((size_t)(g.n), -1);
+        local.assign((size_t)(g.n), 0);
+        head.clear();
+        sizes.clear();
+        roots.clear();
+        std::vector<idx_t> low((size_t)(g.n));
+        std::vector<idx_t> parent((size_t)(g.n), -1);
+        std::vector<idx_t> open;
+        std::stack<std::pair<idx_t, neighbor_cursor<idx_t>>> dfs;
+        idx_t curr_dfs = 1;
+
+        for (idx_t r = 0; r < g.n; r++) {
+            if (dfs_no[r] != 0 || g.adj(r).size() == 0) continue;
+            roots.push_back(r);
+            dfs.emplace(r, g.adj(r).begin());
+            dfs_no[r] = low[r] = curr_dfs++;
+
+            while (!dfs.empty()) {
+                idx_t w = dfs.top().first;
+                idx_t u = *dfs.top().second;
+
+                if (dfs_no[u] == 0) {
+                    dfs.emplace(u, g.adj(u).begin());
+                    open.push_back(u);
+                    parent[u] = w;
+                    dfs_no[u] = low[u] = curr_dfs++;
+                    continue;
+                }
+
+                if (parent[u] != w && dfs_no[u] < dfs_no[w] && u != parent[w]) {
+                    if (dfs_no[u] < low[w]) low[w] = dfs_no[u];
+                }
+                if (!(++dfs.top().second).done()) continue;
+                dfs.pop();
+                if (w == r) continue;
+
+                // w's subtree is done, once however many edges lead to it
+                idx_t v = parent[w];
+                if (low[w] >= dfs_no[v]) {
+                    idx_t b = count();
+                    idx_t size = 1;
+                    idx_t x;
+                    do {
+                        x = open.back();
+                        open.pop_back();
+                        home[x] = b;
+                        local[x] = size++;
+                    } while (x != w);
+                    head.push_back(v);
+                    sizes.push_back(size);
+                }
+                if (low[w] < low[v]) low[v] = low[w];
+            }
+        }
+    }
+};
+
+// whether G + uv is SP, for many candidate edges uv of one base graph G
+// whose edges are connected. insertable counts isolated vertices of G as new,
+// as the maximal SP subgraph wants; insertable_spanning asks for G + uv as a
+// whole, so no isolated vertex may be left beside u and v. G is split
+// once into its blocks, each block recognized on its own and indexed as for
+// two-terminal queries. a graph is SP iff its block-cut tree is a path whose
+// cut vertices lie in two blocks each, with no K4 in any block and the two
+// cut vertices of every inner block sharing a skeleton. uv merges the
+// blocks B_1 .. B_j on the block-cut path from u to v into one block M,
+// which is the 2-sum of a cycle u, d_1 .. d_j-1, v with every B_i + x_i y_i,
+// x_i and y_i being the spine vertices B_i meets. so M has no K4 iff x_i and
+// y_i share a skeleton of every B_i, a vertex joining three blocks is only
+// allowed if it is one of the d_i, and a block with more than two cut
+// vertices, or two that share no skeleton, only if it is one of the B_i.
+// the cut vertices of M must be at most two, and two must share a skeleton
+// of M. a query takes time linear in the length of the path
+template <typename idx_t>
+struct sp_edge_insertion {
+    idx_t n = 0;
+    bool usable = false; // the edges of G are connected and no block has a K4
+    bool empty = false; // G has no edges
+    idx_t n_isolated = 0;
+    graph_blocks<idx_t> parts;
+    idx_t n_blocks = 0;
+    idx_t root_block = -1; // the block of the dfs root, unless it is a cut vertex
+    std::vector<idx_t> blocks; // per vertex: the blocks containing it
+    std::vector<idx_t> cut_node; // per vertex joining blocks: its node of the block-cut tree
+    std::vector<idx_t> cut_vertex; // per cut node, from n_blocks on
+    std::vector<idx_t> up; // per node of the block-cut tree: its parent, -1 at the root
+    std::vector<idx_t> depth; // per node
+    std::vector<std::vector<idx_t>> cuts; // per block: its cut vertices
+    std::vector<char> bridge; // per block: a single edge
+    std::vector<char> bad; // per block: more than two cut vertices, or two sharing no skeleton
+    std::vector<sp_terminal_pairs<idx_t>> pairs; // per block but bridges, on local ids
+    sp_terminal_pairs<idx_t> whole; // instead of pairs, when G itself is SP
+    bool from_whole = false;
+    idx_t n_bad = 0;
+    idx_t n_joins = 0; // vertices in three or more blocks
+
+    bool share(idx_t b, idx_t x, idx_t y) const {
+        if (from_whole) return bridge[b] || whole.share(x, y);
+        return bridge[b] || pairs[b].share(parts.id(x, b), parts.id(y, b));
+    }
+
+    bool share_after(idx_t b, idx_t x, idx_t y, idx_t s, idx_t t) const {
+        if (from_whole) return bridge[b] || whole.share_after(x, y, s, t);
+        return bridge[b] || pairs[b].share_after(parts.id(x, b), parts.id(y, b), parts.id(s, b), parts.id(t, b));
+    }
+
+    // node of the block-cut tree holding v
+    idx_t node(idx_t v) const {
+        return (cut_node[v] != -1 ? cut_node[v] : (parts.home[v] != -1 ? parts.home[v] : root_block));
+    }
+
+    // known, if given, is the recognition of g itself and spares recognizing
+    // the blocks again: the tree of an SP graph indexes all its blocks at
+    // once, on global ids, and a K4, or a prefilter verdict that implies
+    // one, leaves nothing to index. other graphs have their blocks recognized
+    void build(graph<idx_t> const& g, int threads = 1, sp_result<idx_t> const * known = nullptr) {
+        n = g.n;
+        usable = false;
+        parts.build(g);
+        empty = parts.roots.empty();
+        n_isolated = (idx_t)(std::count(parts.dfs_no.begin(), parts.dfs_no.end(), 0));
+        if (parts.roots.size() != 1) return;
+        n_blocks = parts.count();
+
+        bridge.assign((size_t)(n_blocks), 0);
+        for (idx_t b = 0; b < n_blocks; b++) bridge[b] = (parts.sizes[b] == 2);
+        from_whole = (known && known->is_sp);
+        if (from_whole) {
+            whole.build(*known, n);
+            pairs.clear();
+        } else if (known && (std::holds_alternative<negative_cert_K4<idx_t>>(known->reason(verdict::gsp))
+                             || std::holds_alternative<negative_cert_edge_count<idx_t>>(known->reason(verdict::gsp))
+                             || std::holds_alternative<negative_cert_min_degree<idx_t>>(known->reason(verdict::gsp)))) {
+            return;
+        } else {
+            std::vector<std::vector<edge_t<idx_t>>> edges((size_t)(n_blocks));
+            for (idx_t v = 0; v < n; v++) {
+                for (idx_t w : g.adj(v)) {
+                    if (parts.dfs_no[w] < parts.dfs_no[v]) edges[parts.home[v]].emplace_back(parts.local[v], parts.id(w, parts.home[v]));
+                }
+            }
+
+            pairs.assign((size_t)(n_blocks), sp_terminal_pairs<idx_t>{});
+            std::atomic<bool> k4_free{true};
+            parallel_blocks<idx_t>(0, n_blocks, threads, [&](idx_t lo, idx_t hi) {
+                for (idx_t b = lo; b < hi; b++) {
+                    if (bridge[b]) continue;
+                    graph<idx_t> part;
+                    graph_from_edges(parts.sizes[b], edges[b], part);
+                    sp_result<idx_t> r = SP_RECOGNITION(part);
+                    if (!r.is_sp) k4_free = false;
+                    else pairs[b].build(r, parts.sizes[b]);
+                }
+            });
+            if (!k4_free) return;
+        }
+
+        // the block-cut tree: blocks first, then one node per cut vertex. a
+        // block hangs from the cut node of its head, a cut node from the
+        // home of its vertex; blocks close children first, so parents have
+        // the higher ids
+        std::vector<idx_t> count((size_t)(n), 0);
+        for (idx_t v = 0; v < n; v++) count[v] += (parts.home[v] != -1);
+        for (idx_t b = 0; b < n_blocks; b++) count[parts.head[b]]++;
+        root_block = (count[parts.roots[0]] == 1 ? n_blocks - 1 : -1);
+
+        cut_node.assign((size_t)(n), -1);
+        cut_vertex.clear();
+        cuts.assign((size_t)(n_blocks), std::vector<idx_t>{});
+        n_joins = 0;
+        for (idx_t v = 0; v < n; v++) {
+            if (count[v] >= 3) n_joins++;
+            if (count[v] < 2) continue;
+            cut_node[v] = n_blocks + (idx_t)(cut_vertex.size());
+            cut_vertex.push_back(v);
+            if (parts.home[v] != -1) cuts[parts.home[v]].push_back(v);
+        }
+        blocks = std::move(count);
+
+        idx_t nodes = n_blocks + (idx_t)(cut_vertex.size());
+        up.assign((size_t)(nodes), -1);
+        depth.assign((size_t)(nodes), 0);
+        for (idx_t b = n_blocks - 1; b >= 0; b--) {
+            idx_t h = parts.head[b];
+            idx_t c = cut_node[h];
+            if (c == -1) continue;
+            cuts[b].push_back(h);
+            up[b] = c;
+            if (parts.home[h] != -1) {
+                up[c] = parts.home[h];
+                depth[c] = depth[up[c]] + 1;
+            }
+            depth[b] = depth[c] + 1;
+        }
+
+        bad.assign((size_t)(n_blocks), 0);
+        n_bad = 0;
+        for (idx_t b = 0; b < n_blocks; b++) {
+            bad[b] = (cuts[b].size() > 2 || (cuts[b].size() == 2 && !share(b, cuts[b][0], cuts[b][1])));
+            n_bad += bad[b];
+        }
+        usable = true;
+    }
+
+    bool insertable(idx_t u, idx_t v) const {
+        if (u == v || u < 0 || v < 0 || u >= n || v >= n) return false;
+        if (empty) return true;
+        if (!usable) return false;
+
+        // a new vertex hangs a bridge off the other, which must then be in
+        // an end block of an SP graph, away from its cut vertex
+        if (parts.dfs_no[u] == 0) std::swap(u, v);
+        if (parts.dfs_no[v] == 0) {
+            if (parts.dfs_no[u] == 0 || n_joins != 0 || n_bad != 0 || blocks[u] != 1) return false;
+            idx_t b = node(u);
+            return cuts[b].empty() || (cuts[b].size() == 1 && share(b, u, cuts[b][0]));
+        }
+
+        // the block-cut path, from both ends up to where they meet
+        std::vector<idx_t> from_u{node(u)}, from_v{node(v)};
+        while (from_u.back() != from_v.back()) {
+            if (depth[from_u.back()] >= depth[from_v.back()]) from_u.push_back(up[from_u.back()]);
+            else from_v.push_back(up[from_v.back()]);
+        }
+        from_u.insert(from_u.end(), from_v.rbegin() + 1, from_v.rend());
+        std::vector<idx_t> const& path = from_u;
+
+        // the spine vertex at position i of the path, u and v at its ends
+        auto at = [&](size_t i) {
+            return (i == 0 ? u : (i + 1 == path.size() ? v : cut_vertex[path[i] - n_blocks]));
+        };
+
+        // cut vertices of M: where they are on the path, and whether on the spine
+        struct cut_of_m {
+            idx_t v;
+            size_t i;
+            bool spine;
+        };
+        std::vector<cut_of_m> outer;
+        idx_t joins = 0, bad_on_path = 0;
+        for (size_t i = 0; i < path.size(); i++) {
+            if (path[i] >= n_blocks) {
+                if (i == 0 || i + 1 == path.size()) continue;
+                idx_t d = at(i);
+                if (blocks[d] > 3) return false;
+                if (blocks[d] == 3) {
+                    joins++;
+                    outer.push_back(cut_of_m{d, i, true});
+                }
+                continue;
+            }
+
+            idx_t b = path[i];
+            bad_on_path += bad[b];
+            idx_t x = (i == 0 ? u : at(i - 1)), y = (i + 1 == path.size() ? v : at(i + 1));
+            if (!share(b, x, y)) return false;
+            if (cuts[b].size() > 4) return false;
+            for (idx_t c : cuts[b]) {
+                if (c == u || c == v) outer.push_back(cut_of_m{c, i, true});
+                else if (c != x && c != y) outer.push_back(cut_of_m{c, i, false});
+            }
+            if (outer.size() > 2) return false;
+        }
+        if (joins != n_joins || bad_on_path != n_bad) return false;
+        if (outer.size() < 2) return true;
+
+        // the two cut vertices of M share a skeleton if both are on the cycle,
+        // or else both are in one B_i + x_i y_i and share one there
+        idx_t s = outer[0].v, t = outer[1].v;
+        bool s_spine = outer[0].spine, t_spine = outer[1].spine;
+        if (s_spine && t_spine) return true;
+        size_t i = (s_spine ? outer[1].i : outer[0].i);
+        idx_t b = path[i];
+        idx_t x = (i == 0 ? u : at(i - 1)), y = (i + 1 == path.size() ? v : at(i + 1));
+        auto in_piece = [&](idx_t z, bool spine) {
+            return spine ? (z == x || z == y) : (parts.home[z] == b || parts.head[b] == z);
+        };
+        if (!in_piece(s, s_spine) || !in_piece(t, t_spine)) return false;
+        return share_after(b, x, y, s, t);
+    }
+
+    bool insertable_spanning(idx_t u, idx_t v) const {
+        return insertable(u, v) && (parts.dfs_no[u] == 0) + (parts.dfs_no[v] == 0) == n_isolated;
+    }
+
+    std::vector<char> insertable(std::vector<edge_t<idx_t>> const& candidates, bool spanning, int threads = 1) const {
+        std::vector<char> res(candidates.size());
+        parallel_blocks<int64_t>(0, (int64_t)(candidates.size()), threads, [&](int64_t lo, int64_t hi) {
+            for (int64_t i = lo; i < hi; i++) {
+                idx_t u = candidates[i].first, v = candidates[i].second;
+                res[i] = (spanning ? insertable_spanning(u, v) : insertable(u, v));
+            }
+        });
+        return res;
+    }
+};
+
+// ==================== MAXIMAL SP SUBGRAPH ====================
+// a maximal SP subgraph of G: edges whose graph, without isolated vertices,
+// is SP, and to which no other edge of G can be added. found in three steps.
+// blocks: a block of G with a K4 is thinned to a partial 2-tree, which has
+// none, and split into blocks again; blocks without a K4 are settled for
+// good. so every edge is recognized at most twice.
+// path: the settled blocks form a block-cut forest, and a dynamic program
+// over it keeps the heaviest path of blocks that is SP, one on which the
+// two cut vertices of every inner block share a skeleton.
+// closure: the removed edges are offered back, each tested against what is
+// kept with sp_edge_insertion, until a full round adds none
+template <typename idx_t>
+struct sp_subgraph {
+    idx_t n = 0;
+    std::vector<edge_t<idx_t>> edges; // of G, smaller endpoint first
+    std::vector<double> weights; // parallel to edges, empty if G is unweighted
+    std::vector<char> kept; // per edge
+    std::vector<idx_t> removed; // the edges not kept
+    idx_t rechecks = 0; // blocks recognized
+    int64_t recheck_edges = 0; // edges in them
+    idx_t restored = 0; // edges the closure put back
+
+    // a subgraph that is one block: its vertices, so their local ids, and its edges
+    struct piece {
+        std::vector<idx_t> verts;
+        std::vector<idx_t> ids;
+    };
+
+    // the graph of the edges ids on the vertices verts, in local ids
+    void local_graph(piece const& p, std::vector<idx_t>& where, graph<idx_t>& h) const {
+        std::vector<edge_t<idx_t>> local;
+        local.reserve(p.ids.size());
+        for (size_t i = 0; i < p.verts.size(); i++) where[p.verts[i]] = (idx_t)(i);
+        for (idx_t k : p.ids) local.emplace_back(where[edges[k].first], where[edges[k].second]);
+        graph_from_edges((idx_t)(p.verts.size()), local, h);
+    }
+
+    // the blocks of p, each as a piece of its own
+    void split(piece const& p, std::vector<idx_t>& where, std::vector<piece>& out) const {
+        graph<idx_t> h;
+        local_graph(p, where, h);
+        graph_blocks<idx_t> parts;
+        parts.build(h);
+
+        size_t first = out.size();
+        out.resize(first + (size_t)(parts.count()));
+        for (idx_t b = 0; b < parts.count(); b++) {
+            out[first + b].verts.resize((size_t)(parts.sizes[b]));
+            out[first + b].verts[0] = p.verts[parts.head[b]];
+        }
+        for (idx_t v = 0; v < h.n; v++) {
+            if (parts.home[v] != -1) out[first + parts.home[v]].verts[parts.local[v]] = p.verts[v];
+        }
+        for (idx_t k : p.ids) {
+            idx_t b = parts.block_of(where[edges[k].first], where[edges[k].second]);
+            out[first + b].ids.push_back(k);
+        }
+    }
+
+    // thins p, a block with a K4, to a partial 2-tree: in dfs order every
+    // vertex keeps the edges to both ends of a kept edge between two of its
+    // ancestors, one of them its parent if it can, or else its tree edge
+    // alone. each vertex joins on one kept edge or hangs by one, so no K4
+    // can form and at most 2n - 3 edges stay. h is p in the local ids where
+    // gives
+    void thin(piece& p, std::vector<idx_t> const& where, graph<idx_t> const& h) {
+        std::vector<std::array<idx_t, 2>> up((size_t)(h.n), std::array<idx_t, 2>{-1, -1}); // kept edges to ancestors
+        auto joined = [&](idx_t x, idx_t y) {
+            return up[x][0] == y || up[x][1] == y || up[y][0] == x || up[y][1] == x;
+        };
+        std::vector<char> seen((size_t)(h.n), 0);
+        std::vector<idx_t> mark((size_t)(h.n), 0);
+        std::stack<std::pair<idx_t, neighbor_cursor<idx_t>>> dfs;
+        dfs.emplace(0, h.adj(0).begin());
+        seen[0] = 1;
+
+        // a vertex's neighbours seen before it are its ancestors
+        while (!dfs.empty()) {
+            idx_t w = dfs.top().first;
+            if (dfs.top().second.done()) {
+                dfs.pop();
+                continue;
+            }
+            idx_t v = *dfs.top().second;
+            ++dfs.top().second;
+            if (seen[v]) continue;
+            seen[v] = 1;
+            up[v][0] = w;
+            for (idx_t u : h.adj(v)) {
+                if (seen[u]) mark[u] = v + 1;
+            }
+            for (idx_t u : h.adj(v)) {
+                if (!seen[u]) continue;
+                idx_t x = -1;
+                for (idx_t y : up[u]) {
+                    if (y != -1 && mark[y] == v + 1) x = y;
+                }
+                if (x == -1 || (up[v][1] != -1 && u != w && x != w)) continue;
+                up[v][0] = u;
+                up[v][1] = x;
+                if (u == w || x == w) break;
+            }
+            dfs.emplace(v, h.adj(v).begin());
+        }
+
+        size_t stay = 0;
+        for (idx_t k : p.ids) {
+            if (joined(where[edges[k].first], where[edges[k].second])) {
+                p.ids[stay++] = k;
+            } else {
+                removed.push_back(k);
+                kept[k] = 0;
+            }
+        }
+        p.ids.resize(stay);
+    }
+
+    void build(graph<idx_t> const& g, sp_result<idx_t> const& result, int threads = 1) {
+        n = g.n;
+        edges.clear();
+        weights.clear();
+        removed.clear();
+        rechecks = restored = 0;
+        recheck_edges = 0;
+        for (idx_t v = 0; v < n; v++) {
+            idx_t slot = 0;
+            for (idx_t w : g.adj(v)) {
+                if (v < w) {
+                    edges.emplace_back(v, w);
+                    if (g.weights()) weights.push_back(g.weight(v, slot));
+                }
+                slot++;
+            }
+        }
+        kept.assign(edges.size(), 1);
+        if (result.is_sp) return;
+
+        // blocks, until none has a K4
+        std::vector<idx_t> where((size_t)(n), -1);
+        std::vector<piece> work, settled;
+        std::vector<sp_terminal_pairs<idx_t>> pairs;
+        piece all;
+        for (idx_t v = 0; v < n; v++) all.verts.push_back(v);
+        for (idx_t k = 0; k < (idx_t)(edges.size()); k++) all.ids.push_back(k);
+        split(all, where, work);
+        all = piece{};
+
+        while (!work.empty()) {
+            piece p = std::move(work.back());
+            work.pop_back();
+            if (p.ids.size() == 1) {
+                settled.push_back(std::move(p));
+                pairs.emplace_back();
+                continue;
+            }
+
+            graph<idx_t> h;
+            local_graph(p, where, h);
+            sp_result<idx_t> r = SP_RECOGNITION(h);
+            rechecks++;
+            recheck_edges += (int64_t)(p.ids.size());
+            if (r.is_sp) {
+                pairs.emplace_back();
+                pairs.back().build(r, h.n);
+                settled.push_back(std::move(p));
+                continue;
+            }
+
+            thin(p, where, h);
+            split(p, where, work);
+        }
+
+        choose_path(settled, pairs, where);
+        for (idx_t k = 0; k < (idx_t)(edges.size()); k++) {
+            if (kept[k] == 2) kept[k] = 1;
+            else if (kept[k] == 1) {
+                kept[k] = 0;
+                removed.push_back(k);
+            }
+        }
+        close(threads);
+    }
+
+    // marks the edges of the heaviest SP path of settled blocks with 2. the
+    // forest is rooted at a block of each tree; f(p) is the heaviest path
+    // down from block p, entered at its parent cut vertex, and a path
+    // tops out either at a block, going down through up to two of its child
+    // cut vertices that share a skeleton, or at a cut vertex, going down
+    // through two of its child blocks
+    void choose_path(std::vector<piece> const& settled, std::vector<sp_terminal_pairs<idx_t>> const& pairs, std::vector<idx_t>& where) {
+        idx_t n_pieces = (idx_t)(settled.size());
+        std::vector<idx_t> start((size_t)(n) + 1, 0);
+        for (piece const& p : settled) {
+            for (idx_t v : p.verts) start[v + 1]++;
+        }
+        for (idx_t v = 0; v < n; v++) start[v + 1] += start[v];
+        std::vector<idx_t> pieces_of((size_t)(start[n]));
+        std::vector<idx_t> at(start.begin(), start.end() - 1);
+        for (idx_t q = 0; q < n_pieces; q++) {
+            for (idx_t v : settled[q].verts) pieces_of[at[v]++] = q;
+        }
+        auto is_cut = [&](idx_t v) {return start[v + 1] - start[v] >= 2;};
+
+        std::vector<idx_t> parent_cut((size_t)(n_pieces), -1);
+        std::vector<char> seen((size_t)(n_pieces), 0);
+        std::vector<idx_t> order;
+        for (idx_t root = 0; root < n_pieces; root++) {
+            if (seen[root]) continue;
+            seen[root] = 1;
+            order.push_back(root);
+            for (size_t i = order.size() - 1; i < order.size(); i++) {
+                idx_t q = order[i];
+                for (idx_t v : settled[q].verts) {
+                    if (!is_cut(v) || v == parent_cut[q]) continue;
+                    for (idx_t j = start[v]; j < start[v + 1]; j++) {
+                        idx_t child = pieces_of[j];
+                        if (seen[child]) continue;
+                        seen[child] = 1;
+                        parent_cut[child] = v;
+                        order.push_back(child);
+                    }
+                }
+            }
+        }
+
+        std::vector<int64_t> f((size_t)(n_pieces), 0);
+        std::vector<idx_t> next((size_t)(n_pieces), -1); // child cut vertex the path down from q takes
+        std::vector<int64_t> down((size_t)(n), 0); // per cut vertex: best f of its child blocks
+        std::vector<idx_t> down_via((size_t)(n), -1);
+        std::vector<int64_t> val;
+        int64_t best = -1;
+        idx_t best_at = -1, best_c1 = -1, best_c2 = -1; // a block and up to two cut vertices, or a cut vertex and two blocks
+        bool at_cut = false;
+
+        for (size_t i = order.size(); i-- > 0;) {
+            idx_t q = order[i];
+            piece const& p = settled[q];
+            sp_terminal_pairs<idx_t> const& tp = pairs[q];
+            bool single = (p.ids.size() == 1);
+            int64_t w = (int64_t)(p.ids.size());
+
+            // child cut vertices, and the best two ways down from each
+            std::vector<idx_t> children;
+            for (idx_t v : p.verts) {
+                if (!is_cut(v) || v == parent_cut[q]) continue;
+                children.push_back(v);
+                int64_t f1 = -1, f2 = -1;
+                idx_t p1 = -1, p2 = -1;
+                for (idx_t j = start[v]; j < start[v + 1]; j++) {
+                    idx_t child = pieces_of[j];
+                    if (child == q) continue;
+                    if (f[child] > f1) {
+                        f2 = f1;
+                        p2 = p1;
+                        f1 = f[child];
+                        p1 = child;
+                    } else if (f[child] > f2) {
+                        f2 = f[child];
+                        p2 = child;
+                    }
+                }
+                down[v] = f1;
+                down_via[v] = p1;
+                if (p2 != -1 && f1 + f2 > best) {
+                    best = f1 + f2;
+                    best_at = v;
+                    best_c1 = p1;
+                    best_c2 = p2;
+                    at_cut = true;
+                }
+            }
+
+            for (size_t j = 0; j < p.verts.size(); j++) where[p.verts[j]] = (idx_t)(j);
+            auto share = [&](idx_t x, idx_t y) {return single || tp.share(where[x], where[y]);};
+
+            f[q] = w;
+            idx_t parent = parent_cut[q];
+            idx_t c_single = -1;
+            for (idx_t c : children) {
+                if (parent != -1 && share(parent, c) && w + down[c] > f[q]) {
+                    f[q] = w + down[c];
+                    next[q] = c;
+                }
+                if (c_single == -1 || down[c] > down[c_single]) c_single = c;
+            }
+            if (c_single == -1 && w > best) {
+                best = w;
+                best_at = q;
+                best_c1 = best_c2 = -1;
+                at_cut = false;
+            } else if (c_single != -1 && w + down[c_single] > best) {
+                best = w + down[c_single];
+                best_at = q;
+                best_c1 = c_single;
+                best_c2 = -1;
+                at_cut = false;
+            }
+
+            // two child cut vertices sharing a skeleton: both on one chain,
+            // the terminals of the root, or the two ends of a bridge
+            auto consider = [&](idx_t c1, idx_t c2) {
+                if (w + down[c1] + down[c2] > best) {
+                    best = w + down[c1] + down[c2];
+                    best_at = q;
+                    best_c1 = c1;
+                    best_c2 = c2;
+                    at_cut = false;
+                }
+            };
+            if (single) {
+                if (children.size() == 2) consider(children[0], children[1]);
+            } else if (children.size() >= 2) {
+                val.assign(p.verts.size(), -1);
+                for (idx_t c : children) val[where[c]] = down[c];
+                std::vector<std::pair<idx_t, idx_t>> top(tp.ends.size(), {-1, -1});
+                auto offer = [&](idx_t k, idx_t l) {
+                    std::pair<idx_t, idx_t>& t = top[k];
+                    if (val[l] < 0 || t.first == l || t.second == l) return;
+                    if (t.first == -1 || val[l] > val[t.first]) {
+                        t.second = t.first;
+                        t.first = l;
+                    } else if (t.second == -1 || val[l] > val[t.second]) {
+                        t.second = l;
+                    }
+                };
+                for (idx_t c : children) {
+                    if (tp.chain[where[c]] != -1) offer(tp.chain[where[c]], where[c]);
+                }
+                for (idx_t k = 0; k < (idx_t)(tp.ends.size()); k++) {
+                    offer(k, tp.ends[k].first);
+                    offer(k, tp.ends[k].second);
+                    if (top[k].second != -1) consider(p.verts[top[k].first], p.verts[top[k].second]);
+                }
+                if (val[tp.root.first] >= 0 && val[tp.root.second] >= 0) consider(p.verts[tp.root.first], p.verts[tp.root.second]);
+            }
+        }
+
+        // mark the path
+        auto take = [&](idx_t q) {
+            while (true) {
+                for (idx_t k : settled[q].ids) kept[k] = 2;
+                if (next[q] == -1) return;
+                q = down_via[next[q]];
+            }
+        };
+        if (best_at == -1) return;
+        if (at_cut) {
+            take(best_c1);
+            take(best_c2);
+            return;
+        }
+        for (idx_t k : settled[best_at].ids) kept[k] = 2;
+        if (best_c1 != -1) take(down_via[best_c1]);
+        if (best_c2 != -1) take(down_via[best_c2]);
+    }
+
+    // offers the removed edges back, in order and round after round, until
+    // a whole round adds none
+    void close(int threads) {
+        std::vector<edge_t<idx_t>> in;
+        for (idx_t k = 0; k < (idx_t)(edges.size()); k++) {
+            if (kept[k]) in.push_back(edges[k]);
+        }
+        graph<idx_t> h;
+        sp_edge_insertion<idx_t> what_if;
+        graph_from_edges(n, in, h);
+        what_if.build(h, threads);
+
+        size_t since = 0; // removed edges refused since the last one put back
+        for (size_t i = 0; since < removed.size(); i = (i + 1) % removed.size()) {
+            idx_t k = removed[i];
+            if (kept[k] || !what_if.insertable(edges[k].first, edges[k].second)) {
+                since++;
+                continue;
+            }
+            kept[k] = 1;
+            restored++;
+            since = 0;
+            in.push_back(edges[k]);
+            graph_from_edges(n, in, h);
+            what_if.build(h, threads);
+        }
+        removed.erase(std::remove_if(removed.begin(), removed.end(), [&](idx_t k) {return kept[k] != 0;}), removed.end());
+    }
 
-        L_LOG("====== AUTH SUCCESS ======\n\n")
-        verified = true;
-        return true;
+    // the kept edges as a graph file
+    bool save(const char * path) const {
+        std::ofstream os(path);
+        idx_t m = (idx_t)(std::count(kept.begin(), kept.end(), 1));
+        os << n << " " << m << (weights.empty() ? "\n" : " 1\n");
+        os << std::setprecision(17);
+        for (size_t k = 0; k < edges.size(); k++) {
+            if (!kept[k]) continue;
+            os << edges[k].first << " " << edges[k].second;
+            if (!weights.empty()) os << " " << weights[k];
+            os << "\n";
+        }
+        return (bool)(os);
     }
 };
 
-struct negative_cert_tri_comp_cut : certificate {
-    int v;
+// ==================== TREE DECOMPOSITION EXPORT ====================
+// a width-2 tree decomposition of a GSP graph, read off its decomposition
+// tree in one walk: a series node's bag is its terminals and the vertex
+// between its children, any other node's bag its two terminals. a node whose
+// bag lies within the nearest bag kept above it is merged into that bag, so
+// edge leaves and parallel nodes add none, and a vertex's bags stay
+// connected. components hang from the first one's root bag, and a vertex on
+// no edge gets a bag of its own. written in the PACE .td format, vertices
+// numbered from 1
+template <typename idx_t>
+struct sp_tree_decomposition {
+    std::vector<std::array<idx_t, 3>> bags; // -1 after the last vertex
+    std::vector<idx_t> up; // per bag: the bag it hangs from, -1 at the root
+    idx_t n = 0;
+    int largest = 0; // vertices in the largest bag
+
+    idx_t add_bag(std::array<idx_t, 3> const& bag, idx_t parent) {
+        bags.push_back(bag);
+        up.push_back(parent);
+        int size = 0;
+        while (size < 3 && bag[size] != -1) size++;
+        largest = std::max(largest, size);
+        return (idx_t)(bags.size()) - 1;
+    }
 
-    bool authenticate(graph const& g) override {
-        if (verified) return true;
-        L_LOG("====== AUTHENTICATE THREE-COMPONENT CUT VERTEX: " << v << " ======\n")
+    static bool within(std::array<idx_t, 3> const& x, std::array<idx_t, 3> const& y) {
+        for (idx_t v : x) {
+            if (v != -1 && v != y[0] && v != y[1] && v != y[2]) return false;
+        }
+        return true;
+    }
 
-        int comps = num_comps_after_removal(g, v);
+    // the bags of tree t, hung from bag parent; names maps t's vertices to G's
+    void add_tree(sp_tree<idx_t> const& t, idx_t parent, std::vector<char>& covered, std::vector<idx_t> const * names = nullptr) {
+        auto id = [&](idx_t v) {return (names ? (*names)[v] : v);};
+        std::vector<idx_t> kept; // per node on the walk's path: the bag it is merged into
+        sp_tree_walk(t.root, [&](sp_tree_node<idx_t> * curr, sp_visit phase) {
+            if (phase == sp_visit::post) kept.pop_back();
+            if (phase != sp_visit::pre) return true;
+
+            std::array<idx_t, 3> bag = {-1, -1, -1};
+            int size = 0;
+            auto put = [&](idx_t v) {
+                v = id(v);
+                covered[v] = 1;
+                if (v != bag[0] && v != bag[1]) bag[size++] = v;
+            };
+            put(curr->source);
+            put(curr->sink);
+            if (curr->comp == c_type::series) put(curr->l->sink);
+
+            if (!kept.empty() && within(bag, bags[kept.back()])) {
+                kept.push_back(kept.back());
+            } else {
+                kept.push_back(add_bag(bag, (kept.empty() ? parent : kept.back())));
+            }
+            return true;
+        });
+    }
 
-        if (comps < 3) {
-            L_LOG("====== AUTH FAILED: vertex " << v << " only splits graph into " << comps << " components ======\n\n")
+    // false unless G, or each of its components, is GSP
+    bool build(graph<idx_t> const& g, sp_result<idx_t> const& result, sp_components<idx_t> const& components) {
+        n = g.n;
+        bags.clear();
+        up.clear();
+        largest = 0;
+        std::vector<char> covered((size_t)(g.n), 0);
+
+        if (result.is_gsp) {
+            if (sp_tree<idx_t> const * t = result.decomposition()) add_tree(*t, -1, covered);
+        } else if (std::holds_alternative<negative_cert_disconnected<idx_t>>(result.reason(verdict::sp)) && components.all(verdict::gsp)) {
+            for (typename sp_components<idx_t>::part const& p : components.parts) {
+                sp_tree<idx_t> const * t = p.result.decomposition();
+                if (t) add_tree(*t, (bags.empty() ? -1 : 0), covered, &p.verts);
+            }
+        } else {
             return false;
         }
 
-        N_LOG(comps << " comps after removal\n")
-        L_LOG("====== AUTH SUCCESS ======\n\n")
-
-        verified = true;
+        for (idx_t v = 0; v < g.n; v++) {
+            if (!covered[v]) add_bag({v, -1, -1}, (bags.empty() ? -1 : 0));
+        }
         return true;
     }
-};
-
-struct negative_cert_tri_cut_comp : certificate {
-    int c1, c2, c3;
-
-    bool authenticate(graph const& g) override {
-        if (verified) return true;
-        L_LOG("====== AUTHENTICATE BICOMP WITH THREE CUT VERTICES: cut vertices " << c1 << ", " << c2 << ", " << c3 << " ======\n")
-        N_LOG("verify c1 cut vertex: ")
-        if (!is_cut_vertex(g, c1)) return false;
-        N_LOG("verify c2 cut vertex: ")
-        if (!is_cut_vertex(g, c2)) return false;
-        N_LOG("verify c3 cut vertex: ")
-        if (!is_cut_vertex(g, c3)) return false;
 
-        std::vector<int> dfs_no((size_t)(g.n), 0);
-        std::vector<int> parent((size_t)(g.n)); 
-        std::vector<int> low((size_t)(g.n));
-        int cut_verts[3] = {c1, c2, c3};
+    bool save(const char * path) const {
+        std::ofstream os(path);
+        os << "s td " << bags.size() << " " << largest << " " << n << "\n";
+        for (size_t b = 0; b < bags.size(); b++) {
+            os << "b " << b + 1;
+            for (idx_t v : bags[b]) {
+                if (v != -1) os << " " << v + 1;
+            }
+            os << "\n";
+        }
+        for (size_t b = 0; b < bags.size(); b++) {
+            if (up[b] != -1) os << up[b] + 1 << " " << b + 1 << "\n";
+        }
+        return (bool)(os);
+    }
+};
 
-        std::stack<edge_t> comp_edges;
-        std::stack<std::pair<int, int>> dfs;
+// the block-cut forest of G, from graph_blocks: a node per block, then one
+// per cut vertex, joined as in sp_edge_insertion. a vertex on no edge is a
+// block of its own. written in the style of .td: "s bc" with the counts of
+// blocks, cut vertices and vertices, "b i" with block i's vertices, "a j"
+// with cut node j's vertex, then the edges between nodes, numbered from 1
+template <typename idx_t>
+struct sp_block_cut_tree {
+    idx_t n = 0;
+    std::vector<std::vector<idx_t>> blocks; // per block: its vertices, head first
+    std::vector<idx_t> cut_vertex; // per cut node, numbered from blocks.size()
+    std::vector<edge_t<idx_t>> edges; // block, cut node
+
+    void build(graph<idx_t> const& g) {
+        n = g.n;
+        graph_blocks<idx_t> parts;
+        parts.build(g);
+        idx_t n_blocks = parts.count();
+
+        blocks.assign((size_t)(n_blocks), std::vector<idx_t>{});
+        for (idx_t b = 0; b < n_blocks; b++) {
+            blocks[b].resize((size_t)(parts.sizes[b]));
+            blocks[b][0] = parts.head[b];
+        }
+        std::vector<idx_t> count((size_t)(n), 0);
+        for (idx_t v = 0; v < n; v++) {
+            if (parts.home[v] != -1) {
+                blocks[parts.home[v]][parts.local[v]] = v;
+                count[v]++;
+            } else if (parts.dfs_no[v] == 0) {
+                blocks.push_back(std::vector<idx_t>{v});
+            }
+        }
+        for (idx_t b = 0; b < n_blocks; b++) count[parts.head[b]]++;
+
+        std::vector<idx_t> cut_node((size_t)(n), -1);
+        cut_vertex.clear();
+        edges.clear();
+        for (idx_t v = 0; v < n; v++) {
+            if (count[v] < 2) continue;
+            cut_node[v] = (idx_t)(blocks.size() + cut_vertex.size());
+            cut_vertex.push_back(v);
+            if (parts.home[v] != -1) edges.emplace_back(parts.home[v], cut_node[v]);
+        }
+        for (idx_t b = 0; b < n_blocks; b++) {
+            idx_t c = cut_node[parts.head[b]];
+            if (c != -1) edges.emplace_back(b, c);
+        }
+    }
 
-        dfs.emplace(0, 0);
-        dfs_no[0] = 1;
-        low[0] = 1;
-        parent[0] = -1;
-        int curr_dfs = 2;
+    bool save(const char * path) const {
+        std::ofstream os(path);
+        os << "s bc " << blocks.size() << " " << cut_vertex.size() << " " << n << "\n";
+        for (size_t b = 0; b < blocks.size(); b++) {
+            os << "b " << b + 1;
+            for (idx_t v : blocks[b]) os << " " << v + 1;
+            os << "\n";
+        }
+        for (size_t c = 0; c < cut_vertex.size(); c++) os << "a " << blocks.size() + c + 1 << " " << cut_vertex[c] + 1 << "\n";
+        for (edge_t<idx_t> const& e : edges) os << e.first + 1 << " " << e.second + 1 << "\n";
+        return (bool)(os);
+    }
+};
 
-        while (!dfs.empty()) {
-            std::pair<int, int> p = dfs.top();
-            int w = p.first;
-            int u = g.adjLists[p.first][p.second];
+// ==================== RESULT CACHE ====================
+// identifies a graph regardless of the order and orientation of its edges:
+// two sums over the edges of independent 64-bit mixes of the edge, smaller
+// endpoint first, so no sort is needed
+struct graph_key {
+    uint64_t h1 = 0;
+    uint64_t h2 = 0;
+    int64_t n = 0;
+    int64_t e = 0; // edges read
+
+    std::string hex() const {
+        std::ostringstream os;
+        os << std::hex << std::setfill('0') << std::setw(16) << h1 << std::setw(16) << h2;
+        return os.str();
+    }
+};
 
-            if (dfs_no[u] == 0) {
-                dfs.push(std::pair{u, 0});
-                comp_edges.emplace(w, u);
-                parent[u] = w;
-                dfs_no[u] = curr_dfs++;
-                low[u] = dfs_no[u];
-                continue;
-            }
+// one pass over the edge lines; false if they are malformed. certify
+// changes the report, so it is part of the key
+inline bool hash_graph(graph_text const& text, graph_header const& h, bool certify, graph_key& key) {
+    key = graph_key{};
+    key.n = h.n;
+    bool in_range = true;
+    bool parsed = parse_edges<int64_t>(text, h.weighted, [&](edge_t<int64_t> edge, double w) {
+        if (key.e == h.e) return false;
+        if (edge.first < 0 || edge.first >= h.n || edge.second < 0 || edge.second >= h.n) return (in_range = false);
+        if (edge.second < edge.first) std::swap(edge.first, edge.second);
+        uint64_t bits = 0;
+        if (h.weighted) std::memcpy(&bits, &w, sizeof(bits));
+        uint64_t x = mix64((uint64_t)(edge.first) * 0x9e3779b97f4a7c15ULL ^ mix64((uint64_t)(edge.second) + bits));
+        key.h1 += x;
+        key.h2 += mix64(x ^ 0x2545f4914f6cdd1dULL);
+        key.e++;
+        return true;
+    });
+    if (!parsed || !in_range) return false;
+    key.h1 = mix64(key.h1 ^ (uint64_t)(key.n) ^ ((uint64_t)(h.weighted) << 63) ^ ((uint64_t)(certify) << 62));
+    key.h2 = mix64(key.h2 + (uint64_t)(key.e));
+    return true;
+}
 
-            if (parent[u] == w) {
-                if (low[u] >= dfs_no[w]) {
-                    bool seen[3] = {false, false, false};
-                    edge_t e;
-                    do {
-                        e = comp_edges.top();
-                        for (int i = 0; i < 3; i++) {
-                            if (e.first == cut_verts[i] || e.second == cut_verts[i]) seen[i] = true;
-                        }
-                        comp_edges.pop();
-                    } while (e != edge_t{w, u});
+// reports of authenticated results, one file per graph key in dir. a hit
+// touches its file. stores add their bytes to a running count, and only when
+// that passes limit is the directory scanned and the least recently touched
+// files evicted, down to three quarters of limit; so a full cache is scanned
+// once per quarter of limit stored, and files other runs added are counted at
+// the next scan. an entry is the printed report, which is all a hit prints
+struct result_cache {
+    std::string dir;
+    size_t limit;
+    std::mutex evicting;
+    size_t bytes = SIZE_MAX; // in dir at the last scan plus stored since; unknown before the first
+
+    result_cache(const char * dir_, size_t limit_) : dir{dir_}, limit{limit_} {
+        mkdir(dir.c_str(), 0755);
+    }
 
-                    if (seen[0] && seen[1] && seen[2]) {
-                        N_LOG("vertices belong to one biconnected component...\n")    
-                        L_LOG("====== AUTH SUCCESS ======\n\n")
-                        verified = true;
-                        return true;
-                    }
-                }
+    std::string path(graph_key const& key) const {
+        return dir + "/" + key.hex() + ".res";
+    }
 
-                if (low[u] < low[w]) low[w] = low[u];
-            } else if (dfs_no[u] < dfs_no[w] && u != parent[w]) {
-                comp_edges.emplace(w, u);
-                if (dfs_no[u] < low[w]) low[w] = dfs_no[u];
-            }
+    bool lookup(graph_key const& key, std::string& report) {
+        std::ifstream is(path(key), std::ios::binary);
+        std::string magic;
+        if (!std::getline(is, magic) || magic != "sp-result 1") return false;
+        report.assign(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>());
+        utimensat(AT_FDCWD, path(key).c_str(), nullptr, 0);
+        return true;
+    }
 
-            if ((size_t)(++dfs.top().second) >= g.adjLists[p.first].size()) {
-                dfs.pop();
-            }
+    // written aside and renamed into place, so readers never see part of it
+    void store(graph_key const& key, std::string const& report) {
+        std::string file = path(key);
+        std::string tmp = file + "." + std::to_string(getpid()) + "." + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+        {
+            std::ofstream os(tmp, std::ios::binary);
+            if (!(os << "sp-result 1\n" << report)) return;
+        }
+        if (rename(tmp.c_str(), file.c_str()) != 0) {
+            unlink(tmp.c_str());
+            return;
         }
+        std::lock_guard<std::mutex> guard{evicting};
+        if (bytes != SIZE_MAX) bytes += sizeof("sp-result 1\n") - 1 + report.size();
+        if (bytes == SIZE_MAX || bytes > limit) evict();
+    }
 
-        L_LOG("====== AUTH FAILED: bicomp does not contain the three cut vertices ======\n\n")
-        return false;
+    // called holding evicting
+    void evict() {
+        DIR * d = opendir(dir.c_str());
+        if (!d) return;
+
+        struct entry {
+            struct timespec touched;
+            size_t bytes;
+            std::string file;
+        };
+        std::vector<entry> entries;
+        size_t total = 0;
+        for (struct dirent * de; (de = readdir(d)); ) {
+            std::string name = de->d_name;
+            if (name.size() < 4 || name.compare(name.size() - 4, 4, ".res") != 0) continue;
+            struct stat st;
+            std::string file = dir + "/" + name;
+            if (stat(file.c_str(), &st) != 0) continue;
+            entries.push_back(entry{st.st_mtim, (size_t)(st.st_size), file});
+            total += (size_t)(st.st_size);
+        }
+        closedir(d);
+
+        std::sort(entries.begin(), entries.end(), [](entry const& a, entry const& b) {
+            return a.touched.tv_sec != b.touched.tv_sec ? a.touched.tv_sec < b.touched.tv_sec : a.touched.tv_nsec < b.touched.tv_nsec;
+        });
+        size_t keep = (total > limit ? limit / 4 * 3 : total);
+        for (size_t i = 0; total > keep && i < entries.size(); i++) {
+            N_LOG("cache: evicting " << entries[i].file << "\n")
+            if (unlink(entries[i].file.c_str()) == 0) total -= entries[i].bytes;
+        }
+        bytes = total;
     }
 };
 
-struct positive_cert_sp : certificate {
-    sp_tree decomposition;
-    bool is_sp;
+// ==================== SCALING STUDY ====================
+#ifdef SP_COUNT_ALLOCS
+// a build with -DSP_COUNT_ALLOCS counts every allocation, so that --scaling
+// can report them per phase; one relaxed increment per call. the other
+// operators new and delete forward to these two
+std::atomic<int64_t> allocation_count{0};
+
+void * operator new(size_t size) {
+    allocation_count.fetch_add(1, std::memory_order_relaxed);
+    void * p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc{};
+    return p;
+}
 
-    bool authenticate(graph const& g) override {
-        if (verified) return true;
+// kept out of line: inlined, gcc sees free() on a pointer from operator new
+// at every delete and warns of a mismatch (-Wmismatched-new-delete)
+__attribute__((noinline)) void operator delete(void * p) noexcept {std::free(p);}
+__attribute__((noinline)) void operator delete(void * p, size_t) noexcept {std::free(p);}
 
-        std::vector<int> n_src((size_t)(g.n), 0);
-        std::vector<int> n_sink((size_t)(g.n), 0);
-        std::vector<bool> no_edge((size_t)(g.n), false);
-        bool swap = false;
+inline int64_t allocations_so_far() {return allocation_count.load(std::memory_order_relaxed);}
+#else
+inline int64_t allocations_so_far() {return -1;} // not counted
+#endif
 
-        graph g2{};
-        g2.n = g.n;
-        g2.reserve(g);
-        g2.e = 0;
-        
-        std::stack<std::pair<sp_tree_node *, int>> hist;
-        L_LOG("====== AUTHENTICATE SP DECOMPOSITION TREE ======\n")
-        if (!decomposition.root) {
-            L_LOG("====== AUTH FAILED: decomposition tree does not exist ======\n\n")
-            return false;
-        }
+// restarts the peak resident set count from the memory in use, after handing
+// the allocator's free memory back (linux 4.0 and later; elsewhere the peak
+// stays that of the whole process)
+void reset_peak_rss() {
+    malloc_trim(0);
+    std::ofstream os("/proc/self/clear_refs");
+    os << "5";
+}
 
-        hist.emplace(decomposition.root, 0);
+// peak resident set in KB since the last reset_peak_rss()
+int64_t peak_rss_kb() {
+    std::ifstream is("/proc/self/status");
+    std::string key;
+    while (is >> key) {
+        if (key == "VmHWM:") {
+            int64_t kb = 0;
+            is >> kb;
+            return kb;
+        }
+        is.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
 
-        while (!hist.empty()) {
-            sp_tree_node * curr = hist.top().first;
-            V_LOG("traversal: " << *curr << ", phase: " << hist.top().second << "\n")
-            int source = (swap ? curr->sink : curr->source);
-            int sink = (swap ? curr->source : curr->sink);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return (int64_t)(ru.ru_maxrss);
+}
 
-            if (hist.top().second == 0) {
-                if (!(curr->l) || !(curr->r)) {
-                    if (curr->l || curr->r) {
-                        L_LOG("====== AUTH FAILED: node " << *curr << " malformed (one child) ======\n\n")
-                        return false;
-                    }
+// the graph families of the study. each makes a graph on about n vertices
+// and returns its order
+using scaling_rng = std::mt19937_64;
+
+// random two-terminal SP graphs: each new vertex subdivides a random edge or
+// sits on a new path of length two beside it
+int32_t scaling_sp(int32_t n, scaling_rng& rng, std::vector<edge_t<int32_t>>& edges) {
+    edges.emplace_back(0, 1);
+    for (int32_t v = 2; v < n; v++) {
+        size_t k = (size_t)(rng() % edges.size());
+        edge_t<int32_t> uw = edges[k];
+        if (rng() & 1) {
+            edges[k] = edge_t<int32_t>{uw.first, v};
+        } else {
+            edges.emplace_back(uw.first, v);
+        }
+        edges.emplace_back(v, uw.second);
+    }
+    return n;
+}
 
-                    if (curr->comp != c_type::edge) {
-                        L_LOG("====== AUTH FAILED: node " << *curr << " malformed (leaf, but not an edge) ======\n\n")
-                        return false;
-                    }
+// random maximal outerplanar graphs: each new vertex caps an edge of the
+// outer cycle
+int32_t scaling_outerplanar(int32_t n, scaling_rng& rng, std::vector<edge_t<int32_t>>& edges) {
+    std::vector<edge_t<int32_t>> outer{{0, 1}, {1, 2}, {2, 0}};
+    edges = outer;
+    for (int32_t v = 3; v < n; v++) {
+        size_t k = (size_t)(rng() % outer.size());
+        edge_t<int32_t> uw = outer[k];
+        edges.emplace_back(uw.first, v);
+        edges.emplace_back(v, uw.second);
+        outer[k] = edge_t<int32_t>{uw.first, v};
+        outer.emplace_back(v, uw.second);
+    }
+    return n;
+}
 
-                    if (no_edge[source] || no_edge[sink]) {
-                                                L_LOG("====== AUTH FAILED: edge node " << *curr << " is incident on an vertex already merged into a series SP subgraph ======\n\n")
-                        return false;
-                    }
+// a path of 8-cycles, each with one chord, sharing cut vertices: SP only
+// through the second pass over the chain of bicomps
+int32_t scaling_chain(int32_t n, scaling_rng& rng, std::vector<edge_t<int32_t>>& edges) {
+    int32_t blocks = std::max<int32_t>(1, (n - 1) / 7);
+    for (int32_t b = 0; b < blocks; b++) {
+        int32_t first = 7 * b;
+        for (int32_t i = 0; i < 7; i++) edges.emplace_back(first + i, first + i + 1);
+        edges.emplace_back(first + 7, first);
+        int32_t chord = 2 + (int32_t)(rng() % 5);
+        edges.emplace_back(first, first + chord);
+    }
+    return 7 * blocks + 1;
+}
 
-                    g2.add_edge(source, sink);
-                    n_src[source]++;
-                    n_sink[sink]++;
-                    hist.pop();
-                } else {
-                    if (curr->comp == c_type::antiparallel) swap = !swap;
-                    hist.top().second++;
-                    hist.emplace(curr->r, 0);
-                }
-            } else if (hist.top().second == 1) {
-                if (curr->comp == c_type::antiparallel) swap = !swap;
-                hist.top().second++;
-                hist.emplace(curr->l, 0);
-            } else {
-                int lsource = (swap ? curr->r->sink : curr->l->source);
-                int lsink = (swap ? curr->r->source : curr->l->sink);
-                int rsource = (swap ? curr->l->sink : curr->r->source);
-                int rsink = (swap ? curr->l->source : curr->r->sink);
+// the generator's model: 8-cycles joined along a random tree by two edges
+int32_t scaling_cycles(int32_t n, scaling_rng& rng, std::vector<edge_t<int32_t>>& edges) {
+    int32_t cycles = std::max<int32_t>(1, n / 8);
+    for (int32_t c = 0; c < cycles; c++) {
+        for (int32_t i = 0; i < 8; i++) edges.emplace_back(8 * c + i, 8 * c + (i + 1) % 8);
+        if (c == 0) continue;
+        int32_t to = (int32_t)(rng() % c);
+        int32_t x = (int32_t)(rng() % 8);
+        int32_t y = (int32_t)(rng() % 8);
+        edges.emplace_back(8 * c + x, 8 * to + y);
+        edges.emplace_back(8 * c + (x + 1 + (int32_t)(rng() % 6)) % 8, 8 * to + (y + 1 + (int32_t)(rng() % 6)) % 8);
+    }
+    return 8 * cycles;
+}
 
-                switch (curr->comp) {
-                    case c_type::edge:
-                        L_LOG("====== AUTH FAILED: node " << *curr << " malformed (edge, but internal) ======\n\n")
-                        return false;
-                    case c_type::series:
-                        if (lsource != source || rsink != sink || lsink != rsource) {
-                            L_LOG("====== AUTH FAILED: node " << *curr << " malformed (series children source/sink mismatch) ======\n\n")
-                            return false;
-                        }
+// a cycle with two crossing chords: a K4 subdivision whose paths have
+// length n / 4, for certificates that are long to write out
+int32_t scaling_k4_long(int32_t n, scaling_rng&, std::vector<edge_t<int32_t>>& edges) {
+    n = std::max<int32_t>(n, 8);
+    for (int32_t i = 0; i < n; i++) edges.emplace_back(i, (i + 1) % n);
+    edges.emplace_back(0, n / 2);
+    edges.emplace_back(n / 4, 3 * (n / 4));
+    return n;
+}
 
-                        if (n_src[lsink] != 1 || n_sink[lsink] != 1) {
-                            L_LOG("====== AUTH FAILED: series node " << *curr << " has incident edges on its middle vertex " << lsink << " which cannot be merged into it ======\n\n")
-                            return false;
-                        }
+struct scaling_family {
+    const char * name;
+    int32_t (*make)(int32_t, scaling_rng&, std::vector<edge_t<int32_t>>&);
+};
 
-                        V_LOG("BLOCKING: " << lsink << "\n")
-                        no_edge[lsink] = true;
-                        n_src[lsink]--;
-                        n_sink[lsink]--;
-                        break;
-                    case c_type::parallel:
-                        if (lsource != source || rsource != source || lsink != sink || rsink != sink) {
-                            L_LOG("====== AUTH FAILED: node " << *curr << " malformed (parallel children source/sink mismatch) ======\n\n")
-                            return false;
-                        }
+static const scaling_family scaling_families[] = {
+    {"sp", scaling_sp},
+    {"outerplanar", scaling_outerplanar},
+    {"chain", scaling_chain},
+    {"cycles", scaling_cycles},
+    {"k4_long", scaling_k4_long},
+};
 
-                        n_src[source]--;
-                        n_sink[sink]--;
-                        break;
-                    case c_type::antiparallel:
-                        if (swap) {
-                            if (lsource != sink || rsource != source || lsink != source || rsink != sink) {
-                                L_LOG("====== AUTH FAILED: node " << *curr << " malformed (antiparallel children source/sink mismatch) ======\n\n")
-                                return false;
-                            }
-                        } else {
-                            if (lsource != source || rsource != sink || lsink != sink || rsink != source) {
-                                L_LOG("====== AUTH FAILED: node " << *curr << " malformed (antiparallel children source/sink mismatch) ======\n\n")
-                                return false;
-                            }
-                        }
+// the last is no phase of the tools: a walk once around a random cycle
+// through as many entries as the graph has vertices and edges, each step
+// waiting on the one before, as a dfs does. memory latency alone costs that
+// much at each size, so a phase is only flagged when it grows faster than
+// both a linear function and this baseline
+static const char * const scaling_phases[] = {"load", "recognize", "authenticate", "pointer_chase"};
+static const int n_scaling_phases = 4;
+
+// a random permutation that is one cycle (Sattolo's shuffle)
+void make_chase(std::vector<uint32_t>& next, scaling_rng& rng) {
+    std::iota(next.begin(), next.end(), 0);
+    for (size_t i = next.size() - 1; i > 0; i--) std::swap(next[i], next[(size_t)(rng() % i)]);
+}
 
-                        n_src[source]--;
-                        n_sink[sink]--;
-                        break;
-                    case c_type::dangling:
-                        if (is_sp) {
-                            L_LOG("====== AUTH FAILED: illegal dangling composition in SP decomposition tree ======\n\n")
-                            return false;
-                        }
+uint32_t pointer_chase(std::vector<uint32_t> const& next) {
+    uint32_t at = 0;
+    for (size_t i = 0; i < next.size(); i++) at = next[at];
+    return at;
+}
 
-                        if (swap) {
-                            if (rsource != source || rsink != sink || lsink != sink) {
-                                L_LOG("====== AUTH FAILED: node " << *curr << " malformed (dangling children source/sink mismatch) ======\n\n")
-                                return false;
-                            }
-                        } else {
-                            if (lsource != source || lsink != sink || rsource != source) {
-                                L_LOG("====== AUTH FAILED: node " << *curr << " malformed (dangling children source/sink mismatch) ======\n\n")
-                                return false;
-                            }
-                        }
+// one phase on one graph: the fastest of the repetitions, and the peak
+// resident set and allocations of the first
+struct scaling_sample {
+    double seconds = std::numeric_limits<double>::infinity();
+    int64_t rss_kb = 0;
+    int64_t allocations = 0; // -1 unless built with SP_COUNT_ALLOCS
+};
 
-                        if (swap) {
-                            n_src[lsource]--;
-                            n_sink[sink]--;
-                        } else {
-                            n_src[source]--;
-                            n_sink[rsink]--;
-                        }
+// least-squares slope of log y against log x
+double growth_exponent(std::vector<double> const& x, std::vector<double> const& y) {
+    size_t k = x.size();
+    if (k < 2) return 0;
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < k; i++) {
+        double lx = std::log(x[i]);
+        double ly = std::log(std::max(y[i], 1e-9));
+        sx += lx;
+        sy += ly;
+        sxx += lx * lx;
+        sxy += lx * ly;
+    }
+    double den = (double)(k) * sxx - sx * sx;
+    return (den == 0 ? 0 : ((double)(k) * sxy - sx * sy) / den);
+}
 
-                        break;
+// runs every family at n = 1024, 2048, ... up to max_n vertices through
+// loading, recognition and authentication, writes one CSV row per family,
+// size and phase to csv_path, and prints the growth exponent of each phase's
+// time, peak RSS and allocations in n + m, fitted over the larger half of
+// the sizes. an exponent is flagged superlinear when it is more than 0.15
+// above 1, and for time also more than 0.15 above the pointer chase. 1 if a
+// phase is flagged. allocations are fitted only in a SP_COUNT_ALLOCS build
+int run_scaling(const char * csv_path, int64_t max_n, int threads) {
+    std::ofstream csv(csv_path);
+    if (!csv) {
+        std::cerr << "Error: could not open file " << csv_path << "\n";
+        return 1;
+    }
+    csv << "family,n,m,phase,seconds,peak_rss_kb,allocations,verdict\n";
+
+    static const double margin = 0.15;
+    max_n = std::min<int64_t>(max_n, std::numeric_limits<int32_t>::max() / 4);
+    std::vector<int32_t> sizes;
+    for (int64_t n = 1024; n <= max_n; n *= 2) sizes.push_back((int32_t)(n));
+
+    std::cout << "=== Scaling Study ===\n";
+    std::cout << "Exponents of time, peak RSS and allocations in n + m:\n";
+    int flagged = 0;
+
+    for (scaling_family const& family : scaling_families) {
+        std::vector<double> size_of;
+        std::vector<scaling_sample> samples[n_scaling_phases];
+
+        for (int32_t target : sizes) {
+            scaling_rng rng{(uint64_t)(target)};
+            std::vector<edge_t<int32_t>> edges;
+            int32_t n = family.make(target, rng, edges);
+
+            // labels and edge order shuffled, as the generator does
+            std::vector<int32_t> label((size_t)(n));
+            std::iota(label.begin(), label.end(), 0);
+            std::shuffle(label.begin(), label.end(), rng);
+            std::shuffle(edges.begin(), edges.end(), rng);
+            std::string text = std::to_string(n) + " " + std::to_string(edges.size()) + "\n";
+            for (edge_t<int32_t> e : edges) text += std::to_string(label[e.first]) + " " + std::to_string(label[e.second]) + "\n";
+
+            int reps = (int)(std::clamp<int64_t>((int64_t)(1 << 18) / (int64_t)(edges.size()), 3, 16));
+            scaling_sample s[n_scaling_phases];
+            std::string verdict;
+            for (int r = 0; r < reps; r++) {
+                auto measure = [&](int phase, auto const& fn) {
+                    reset_peak_rss();
+                    int64_t before = allocations_so_far();
+                    auto start = std::chrono::steady_clock::now();
+                    fn();
+                    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                    s[phase].seconds = std::min(s[phase].seconds, seconds);
+                    if (r > 0) return;
+                    s[phase].allocations = (before < 0 ? -1 : allocations_so_far() - before);
+                    s[phase].rss_kb = peak_rss_kb();
+                };
+
+                graph<int32_t> g;
+                sp_result<int32_t> result;
+                bool ok = true;
+                measure(0, [&]() {
+                    graph_header h;
+                    const char * body = parse_graph_header(text.data(), text.data() + text.size(), h);
+                    ok = body && read_graph(body, text.data() + text.size(), h, g, threads);
+                });
+                measure(1, [&]() {
+                    if (!sp_prefilter(g, true, result)) result = SP_RECOGNITION(g, threads);
+                });
+                measure(2, [&]() {ok = ok && result.authenticate(g);});
+                if (!ok) {
+                    std::cerr << "Error: " << family.name << " graph on " << n << " vertices failed authentication\n";
+                    return 1;
                 }
-
-                hist.pop();
+                verdict = (result.is_sp ? "sp" : result.is_gsp ? "gsp" : "no");
             }
-        }
-
-        N_LOG("decomposition tree well-formed...\n")
-        n_src[decomposition.root->source]--;
-        n_sink[decomposition.root->sink]--;
 
-        bool failed = false;
-        for (int i = 0; i < g.n; i++) {
-            if (n_src[i] != 0) {
-                N_LOG("OH NO: disconnected SP subgraph sourced at vertex " << i << "\n")
-                failed = true;
-            }
-            
-            if (n_sink[i] != 0) {
-                N_LOG("OH NO: disconnected SP subgraph sinked at vertex " << i << "\n")
-                failed = true;
+            reset_peak_rss();
+            std::vector<uint32_t> chase((size_t)(n) + edges.size());
+            make_chase(chase, rng);
+            volatile uint32_t end = 0;
+            for (int r = 0; r < reps; r++) {
+                auto start = std::chrono::steady_clock::now();
+                end = pointer_chase(chase);
+                s[3].seconds = std::min(s[3].seconds, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
             }
-        }
+            s[3].rss_kb = peak_rss_kb();
+            (void)(end);
 
-        if (failed) {
-            L_LOG("====== AUTH FAILED: additional disconnected SP subgraphs are part of the decomposition tree ======\n\n")
-            return false;
+            for (int phase = 0; phase < n_scaling_phases; phase++) {
+                csv << family.name << "," << n << "," << edges.size() << "," << scaling_phases[phase] << ","
+                    << s[phase].seconds << "," << s[phase].rss_kb << "," << (s[phase].allocations < 0 ? "" : std::to_string(s[phase].allocations)) << "," << verdict << "\n";
+                samples[phase].push_back(s[phase]);
+            }
+            size_of.push_back((double)(n) + (double)(edges.size()));
         }
 
-        N_LOG("decomposition tree connected...\n")
-
-        for (size_t i = 0; i < g2.adjLists.size(); i++) {
-            std::vector<int> l1 = g.adjLists[i];
-            radix_sort(l1);
-            radix_sort(g2.adjLists[i]);
-            if (l1 != g2.adjLists[i]) {
-                L_LOG("====== AUTH FAILED: vertex " << i << " of G does not have the same adjacency list as the one produced by the decomposition tree ======\n\n")
-
-                #ifdef __LOGGING__
-                N_LOG("ORIGINAL GRAPH: ")
-                g2.output_adj_list(i, std::cout);
-                N_LOG("PRODUCED GRAPH: ")
-                g2.output_adj_list(i, std::cout);
-                #endif
-
-                L_LOG("======================================================================\n\n")
-                return false;                
+        size_t from = size_of.size() / 2;
+        std::vector<double> x(size_of.begin() + (ptrdiff_t)(from), size_of.end());
+        double fit[n_scaling_phases][3];
+        bool counted = (allocations_so_far() >= 0);
+        for (int phase = 0; phase < n_scaling_phases; phase++) {
+            std::vector<double> t, rss, allocs;
+            for (size_t i = from; i < size_of.size(); i++) {
+                t.push_back(samples[phase][i].seconds);
+                rss.push_back((double)(samples[phase][i].rss_kb));
+                allocs.push_back(1.0 + (double)(samples[phase][i].allocations));
             }
+            fit[phase][0] = growth_exponent(x, t);
+            fit[phase][1] = growth_exponent(x, rss);
+            fit[phase][2] = (counted ? growth_exponent(x, allocs) : 0);
         }
 
-        N_LOG("decomposition tree produces graph identical to G...\n")
-        L_LOG("====== AUTH SUCCESS ======\n\n")
-
-        verified = true;
-        return true;
+        double baseline = std::max(1.0, fit[n_scaling_phases - 1][0]);
+        for (int phase = 0; phase < n_scaling_phases; phase++) {
+            bool over = (phase < n_scaling_phases - 1) &&
+                        (fit[phase][0] > baseline + margin || fit[phase][1] > 1 + margin || fit[phase][2] > 1 + margin);
+            flagged += over;
+
+            std::ostringstream row;
+            row << std::fixed << std::setprecision(2) << std::left << std::setw(12) << family.name << std::setw(14) << scaling_phases[phase]
+                << std::right << std::setw(6) << fit[phase][0] << std::setw(7) << fit[phase][1];
+            if (counted) row << std::setw(7) << fit[phase][2];
+            else row << std::setw(7) << "-";
+            if (over) row << "  superlinear";
+            std::cout << row.str() << "\n";
+        }
     }
-};
 
-struct sp_result {
-    bool is_sp;
-    std::shared_ptr<certificate> reason;
+    std::cout << (flagged ? std::to_string(flagged) + " phase" + (flagged == 1 ? "" : "s") + " grew faster than linearly" : std::string("every phase grew linearly"))
+              << "; samples written to " << csv_path << "\n";
+    return (flagged ? 1 : 0);
+}
 
-    bool authenticate(graph const& g) {
-        L_LOG("================== AUTHENTICATING SP RESULT ==================\n") 
-        V_LOG(g)
-        V_LOG("=============================================================\n")
-        L_LOG("\n")
+// ==================== MAIN FUNCTION ====================
+template <typename idx_t>
+void print_reason(certificate<idx_t> const& reason, std::ostream& os = std::cout, std::vector<idx_t> const* names = nullptr) {
+    auto id = [&](idx_t v) {return names ? (*names)[v] : v;}; // certificates in local ids name vertices of G
+    if (auto k4 = std::get_if<negative_cert_K4<idx_t>>(&reason)) {
+        os << "Reason: K4 subdivision on vertices {"
+                  << id(k4->a) << "," << id(k4->b) << "," << id(k4->c) << "," << id(k4->d) << "}\n";
+    } else if (auto k23 = std::get_if<negative_cert_K23<idx_t>>(&reason)) {
+        os << "Reason: K23 subdivision between vertices {" 
+                  << id(k23->a) << "," << id(k23->b) << "}\n";
+    } else if (auto t4 = std::get_if<negative_cert_T4<idx_t>>(&reason)) {
+        os << "Reason: T4 (theta-4) subdivision with cut vertices "
+                  << id(t4->c1) << "," << id(t4->c2);
+        if (t4->c1 != t4->d1 || t4->c2 != t4->d2) os << " off corners " << id(t4->d1) << "," << id(t4->d2);
+        os << " and others " << id(t4->a) << "," << id(t4->b) << "\n";
+    } else if (auto tri = std::get_if<negative_cert_tri_comp_cut<idx_t>>(&reason)) {
+        os << "Reason: cut vertex " << id(tri->v) << " splits into >=3 components\n";
+    } else if (auto tric = std::get_if<negative_cert_tri_cut_comp<idx_t>>(&reason)) {
+        os << "Reason: bicomp with 3 cut vertices {"
+                  << id(tric->c1) << "," << id(tric->c2) << "," << id(tric->c3) << "}\n";
+    } else if (auto count = std::get_if<negative_cert_edge_count<idx_t>>(&reason)) {
+        os << "Reason: " << count->e << " edges, more than 2n - 3 = " << 2 * count->n - 3 << "\n";
+    } else if (std::holds_alternative<negative_cert_min_degree<idx_t>>(reason)) {
+        os << "Reason: every vertex has degree at least 3\n";
+    } else if (auto apart = std::get_if<negative_cert_disconnected<idx_t>>(&reason)) {
+        os << "Reason: no path between vertices {" << id(apart->a) << "," << id(apart->b) << "}\n";
+    } else {
+        os << "Reason: unknown (unhandled cert type)\n";
+    }
+}
 
-        if (!reason) {
-            L_LOG("ERROR: reason not given")
-            return false;
-        }
-        if (!reason->authenticate(g)) return false;
+void print_usage(const char* program_name) {
+    std::cerr << "Usage: " << program_name << " [options] <graph_input_file>...\n";
+    std::cerr << "  --mwis            maximum weight independent set (unit vertex weights)\n";
+    std::cerr << "  --spanning-trees  number of spanning trees (weighted by edge weights)\n";
+    std::cerr << "  --threads k       threads for bicomps, components, the dynamic programs and queries (default 1)\n";
+    std::cerr << "  --distances file  shortest-path distances for the vertex pairs \"u v\" in file\n";
+    std::cerr << "  --terminals file  whether the graph is two-terminal SP between each pair \"s t\" in file\n";
+    std::cerr << "  --insertions file whether the graph plus uv is SP, for each edge \"u v\" in file\n";
+    std::cerr << "  --sp-subgraph f   write a maximal SP subgraph to f and list the edges left out\n";
+    std::cerr << "  --td f            write a width-2 tree decomposition of a GSP graph to f (PACE .td)\n";
+    std::cerr << "  --block-cut f     write the block-cut tree to f\n";
+    std::cerr << "  --certify         find a K4 subdivision even when counting edges or degrees rules the graph out\n";
+    std::cerr << "  --fused           authenticate the decomposition tree while it is built, not in a pass after\n";
+    std::cerr << "  --save-oracle f   write the distance oracle to f\n";
+    std::cerr << "  --oracle f        answer --distances from a saved oracle instead of a graph\n";
+    std::cerr << "  --external f      keep the adjacency lists in scratch file f instead of RAM\n";
+    std::cerr << "  --ram-budget MB   adjacency bytes filled per pass with --external (default 1024)\n";
+    std::cerr << "  --packed          hold the adjacency lists delta and varint encoded\n";
+    std::cerr << "  --cache dir       reuse the reports of graphs seen before, kept in dir\n";
+    std::cerr << "  --cache-limit MB  bytes of reports kept in the cache (default 64)\n";
+    std::cerr << "  --stages l,r,a    threads loading, recognizing and authenticating when\n";
+    std::cerr << "                    several input files are given (default 1,1,1)\n";
+    std::cerr << "  --read-depth k    input files read at once ahead of loading (default 8)\n";
+    std::cerr << "  --scaling f.csv   time generated graphs of doubling size instead of reading one,\n";
+    std::cerr << "                    write the samples to f.csv and fit growth exponents\n";
+    std::cerr << "  --scaling-max n   largest graph order for --scaling (default 1048576)\n";
+    std::cerr << "  --trace f         record phases, bicomps and certificates per thread, written to f\n";
+    std::cerr << "  --trace-level k   1: phases, bicomps, certificates; 2: also stack, ear, K23 and\n";
+    std::cerr << "                    composition events (default 1)\n";
+    std::cerr << "  --trace-buffer MB events kept per thread, the latest first (default 32)\n";
+    std::cerr << "  --trace-json f o  convert trace f to Chrome trace JSON o, for Perfetto or chrome://tracing\n";
+}
 
-        L_LOG("this graph is " << (is_sp ? "" : "NOT ") << "SP\n")
-        return true;
+struct options {
+    const char * input = nullptr;
+    bool mwis = false;
+    bool spanning_trees = false;
+    int threads = 1;
+    const char * distance_queries = nullptr;
+    const char * terminal_queries = nullptr;
+    const char * insertion_queries = nullptr;
+    const char * sp_subgraph = nullptr;
+    const char * tree_decomposition = nullptr;
+    const char * block_cut = nullptr;
+    bool certify = false;
+    bool fused = false;
+    const char * save_oracle = nullptr;
+    const char * oracle_file = nullptr;
+    const char * external = nullptr;
+    size_t ram_budget = (size_t)(1024) << 20;
+    bool packed = false;
+    std::vector<const char *> inputs;
+    int stage_threads[3] = {1, 1, 1}; // load, recognize, authenticate
+    int read_depth = 8;
+    const char * cache_dir = nullptr;
+    size_t cache_limit = (size_t)(64) << 20;
+    const char * scaling = nullptr;
+    int64_t scaling_max = (int64_t)(1) << 20;
+    const char * trace = nullptr;
+    int trace_level = 1;
+    size_t trace_buffer = (size_t)(32) << 20;
+    const char * trace_json[2] = {nullptr, nullptr};
+
+    // only the recognition report is cached, so nothing else may be asked for
+    bool cacheable() const {
+        return cache_dir && !external && !mwis && !spanning_trees && !distance_queries && !terminal_queries && !insertion_queries && !sp_subgraph && !tree_decomposition && !block_cut && !save_oracle;
     }
 };
 
-// ==================== MAIN ALGORITHM FUNCTIONS ====================
-int path_contains_edge(std::vector<edge_t> const& path, edge_t test) {
-    for (size_t i = 0; i < path.size(); i++) {
-        edge_t e = path[i];
-        if (e == test || (e.first == test.second && e.second == test.first)) return (int)(i);
-    }
-    return -1;
+template <typename idx_t>
+bool read_queries(const char* path, std::vector<edge_t<idx_t>>& queries) {
+    std::ifstream is(path);
+    if (!is) return false;
+    int64_t u, v;
+    while (is >> u >> v) queries.emplace_back((idx_t)(u), (idx_t)(v));
+    return true;
 }
 
-void report_K4_non_stack_pop_case(sp_result& cert_out,
-                                  std::vector<int> const& parent, 
-                                  std::vector<std::stack<sp_chain_stack_entry>>& vertex_stacks, 
-                                  int a, 
-                                  int b,
-                                  int d,
-                                  int elose,
-                                  int ewin_src,
-                                  int ewin_sink) {
-    std::shared_ptr<negative_cert_K4> k4{new negative_cert_K4{}};
-    k4->a = a;
-    k4->b = b;
-    k4->d = d;
-
-    sp_tree earliest_violating_ear;
-    for (int bw = parent[k4->b]; bw != k4->d; bw = parent[bw]) {
-        for (; !vertex_stacks[bw].empty(); vertex_stacks[bw].pop()) {
-            if (vertex_stacks[bw].top().end == k4->a) {
-                earliest_violating_ear = std::move(vertex_stacks[bw].top().SP);
-                k4->c = bw;
-            }
-        }
+template <typename idx_t>
+void print_distances(std::vector<edge_t<idx_t>> const& queries, std::vector<double> const& dist, std::ostream& os = std::cout) {
+    os << std::setprecision(17);
+    for (size_t i = 0; i < queries.size(); i++) {
+        os << queries[i].first << " " << queries[i].second << " " << dist[i] << "\n";
     }
+}
 
-    for (int a = k4->a; a != k4->b; a = parent[a]) k4->ab.emplace_back(a, parent[a]);
-    for (int b = k4->b; b != k4->c; b = parent[b]) k4->bc.emplace_back(b, parent[b]);
-    for (int c = k4->c; c != k4->d; c = parent[c]) k4->cd.emplace_back(c, parent[c]);
-
-    k4->ad.emplace_back(k4->d, elose);
-    for (int d = elose; d != k4->a; d = parent[d]) k4->ad.emplace_back(d, parent[d]);
-    for (int e = k4->d; e != ewin_src; e = parent[e]) {
-        k4->bd.emplace_back(e, parent[e]);
+template <typename idx_t>
+int run_oracle(options const& opt) {
+    std::vector<edge_t<idx_t>> queries;
+    if (!read_queries(opt.distance_queries, queries)) {
+        std::cerr << "Error: could not open file " << opt.distance_queries << "\n";
+        return 1;
     }
-    k4->bd.emplace_back(ewin_src, ewin_sink);
-    for (int e = ewin_sink; e != k4->b; e = parent[e]) k4->bd.emplace_back(e, parent[e]);
-    int ear_path = earliest_violating_ear.underlying_tree_path_source();
-    k4->ac.emplace_back(k4->c, ear_path);
-    for (; ear_path != k4->a; ear_path = parent[ear_path]) k4->ac.emplace_back(ear_path, parent[ear_path]);
 
-    cert_out.reason = k4;
+    sp_distance_oracle<idx_t> oracle;
+    if (!oracle.map(opt.oracle_file)) {
+        std::cerr << "Error: could not map distance oracle " << opt.oracle_file << "\n";
+        return 1;
+    }
+    print_distances(queries, oracle.distances(queries, opt.threads));
+    return 0;
 }
 
-void K23_test(std::shared_ptr<certificate>& cert_ptr, std::vector<int>& alert, std::vector<int> const& parent, edge_t ear_found, edge_t ear_winning, int w) {
-    V_LOG("testing K23: found ear (" << ear_found.first << ", " << ear_found.second << "), winning ear (" << ear_winning.first << ", " << ear_winning.second << ")\n")
-    if (ear_found.second != parent[w]) {
-        N_LOG("OOPS, 3.5(a) violation, nonouterplanar\n")
-        std::shared_ptr<negative_cert_K23> k23{new negative_cert_K23{}};
-        k23->a = w;
-        k23->b = ear_found.second;
-
-        k23->one.emplace_back(k23->b, ear_found.first);
-        for (int i = ear_found.first; i != k23->a; i = parent[i]) k23->one.emplace_back(i, parent[i]);
+void print_cached(graph_key const& key, std::string const& report, std::ostream& out) {
+    out << "Read graph with " << key.n << " vertices and " << key.e << " edges\n\n";
+    out << "Cached result " << key.hex() << "\n\n";
+    out << report;
+}
 
-        for (int i = k23->a; i != k23->b; i = parent[i]) k23->two.emplace_back(i, parent[i]);
+// one graph of a run, from its input to its report
+template <typename idx_t>
+struct sp_job {
+    const char * input = nullptr;
+    std::vector<edge_t<idx_t>> queries;
+    std::vector<edge_t<idx_t>> terminals;
+    std::vector<edge_t<idx_t>> insertions;
+    graph<idx_t> g;
+    io_stats io;
+    sp_result<idx_t> result;
+    sp_components<idx_t> components; // if g is disconnected
+    struct rusage before, after; // around recognition
+};
 
-        for (int i = k23->b; i != ear_winning.second; i = parent[i]) k23->three.emplace_back(i, parent[i]);
-                k23->three.emplace_back(ear_winning.second, ear_winning.first);
-        for (int i = ear_winning.first; i != k23->a; i = parent[i]) k23->three.emplace_back(i, parent[i]);
+// whether the report may be cached: a prefilter verdict from the edge count
+// or the degrees names no K4 subdivision, and a later --certify run must
+// not be handed one
+template <typename idx_t>
+bool witnessed(sp_job<idx_t> const& job) {
+    auto const& reason = job.result.reason(verdict::sp);
+    return !std::holds_alternative<negative_cert_edge_count<idx_t>>(reason) && !std::holds_alternative<negative_cert_min_degree<idx_t>>(reason);
+}
 
-        cert_ptr = k23;
-        return;
+// parses the edge lines after the header into job.g; false, with the error
+// written to err, if the graph cannot be used
+template <typename idx_t>
+bool load_job(options const& opt, sp_job<idx_t>& job, graph_text const& text, graph_header const& header, std::ostream& out, std::ostream& err) {
+    if (opt.distance_queries && !read_queries(opt.distance_queries, job.queries)) {
+        err << "Error: could not open file " << opt.distance_queries << "\n";
+        return false;
+    }
+    if (opt.terminal_queries && !read_queries(opt.terminal_queries, job.terminals)) {
+        err << "Error: could not open file " << opt.terminal_queries << "\n";
+        return false;
+    }
+    if (opt.insertion_queries && !read_queries(opt.insertion_queries, job.insertions)) {
+        err << "Error: could not open file " << opt.insertion_queries << "\n";
+        return false;
     }
 
-    if (alert[w] != -1) {
-        N_LOG("OOPS, 3.5(b) violation, nonouterplanar\n")
-        std::shared_ptr<negative_cert_K23> k23{new negative_cert_K23{}};
-        k23->a = w;
-        k23->b = ear_found.second;
-
-        k23->one.emplace_back(k23->b, ear_found.first);
-        for (int i = ear_found.first; i != k23->a; i = parent[i]) k23->one.emplace_back(i, parent[i]);
+    graph<idx_t>& g = job.g;
+    trace_scope scope{trace_span::load};
+    bool loaded = (opt.external ? read_graph_external(text, header, g, opt.external, opt.ram_budget, job.io)
+                                : read_graph(text, header, g, opt.threads));
+    if (!loaded) {
+        err << "Error: malformed edge list in " << job.input << "\n";
+        return false;
+    }
+    if (g.n <= 0) {
+        err << "Error: Graph must have at least one vertex\n";
+        return false;
+    }
+    edge_t<idx_t> bad = find_non_simple(g);
+    if (bad.first != -1) {
+        if (bad.first == bad.second) err << "Error: self-loop at vertex " << bad.first;
+        else err << "Error: edge " << bad.first << " " << bad.second << " appears twice";
+        err << " in " << job.input << "; the graph must be simple\n";
+        return false;
+    }
 
-        k23->two.emplace_back(k23->b, alert[w]);
-        for (int i = alert[w]; i != k23->a; i = parent[i]) k23->two.emplace_back(i, parent[i]);
+    out << "Read graph with " << g.n << " vertices and " << g.e << " edges\n\n";
 
-        for (int i = k23->b; i != ear_winning.second; i = parent[i]) k23->three.emplace_back(i, parent[i]);
-        k23->three.emplace_back(ear_winning.second, ear_winning.first);
-        for (int i = ear_winning.first; i != k23->a; i = parent[i]) k23->three.emplace_back(i, parent[i]);
+    if (opt.packed) {
+        size_t raw = g.adjacency_bytes();
+        g.pack();
+        std::ostringstream mb;
+        mb << std::fixed << std::setprecision(1) << raw / 1048576.0 << " MB to " << g.adjacency_bytes() / 1048576.0 << " MB";
+        out << "Packed adjacency lists from " << mb.str() << "\n\n";
+    }
+    return true;
+}
 
-        cert_ptr = k23;
-        return;
-    } else {
-        alert[w] = ear_found.first;
+template <typename idx_t>
+void recognize_job(options const& opt, sp_job<idx_t>& job) {
+    trace_scope scope{trace_span::recognize, (int64_t)(job.g.n)};
+    getrusage(RUSAGE_SELF, &job.before);
+    if (!sp_prefilter(job.g, opt.certify, job.result)) job.result = SP_RECOGNITION(job.g, opt.threads, opt.fused);
+    if (std::holds_alternative<negative_cert_disconnected<idx_t>>(job.result.reason(verdict::sp))) {
+        job.components.build(job.g, opt.certify, opt.threads, opt.fused);
     }
+    getrusage(RUSAGE_SELF, &job.after);
 }
 
-std::vector<edge_t> get_bicomps(graph const& g, std::vector<int>& cut_verts, sp_result& cert_out, int root = 0) {
-    std::vector<int> dfs_no((size_t)(g.n), 0);
-    std::vector<int> parent((size_t)(g.n), 0);
-    std::vector<int> low((size_t)(g.n), 0);
+// prints the results, authenticates the certificates and runs what else
+// was asked for; returns the exit status
+template <typename idx_t>
+int report_job(options const& opt, sp_job<idx_t>& job, std::ostream& out, std::ostream& err) {
+    graph<idx_t> const& g = job.g;
+    sp_result<idx_t>& result = job.result;
+
+    if (opt.external) {
+        std::ostringstream mb;
+        mb << std::fixed << std::setprecision(1) << job.io.text_bytes / 1048576.0 << " MB read, "
+           << job.io.list_bytes / 1048576.0 << " MB of adjacency lists written";
+        out << "=== External Memory ===\n";
+        out << "Loading: " << job.io.passes << " passes over the input, " << mb.str() << "\n";
+        out << "Recognition: " << job.after.ru_majflt - job.before.ru_majflt << " major page faults, "
+            << job.after.ru_inblock - job.before.ru_inblock << " blocks read\n\n";
+    }
+    out << "=== Series-Parallel Recognition Results ===\n";
+    if (result.is_sp) {
+        out << "The graph IS Series-Parallel.\n";
+        auto sp = std::get_if<positive_cert_sp<idx_t>>(&result.reason(verdict::sp));
+        if (sp && sp->decomposition.root) {
+            out << "SP decomposition tree root: {"
+                      << sp->decomposition.source() << ","
+                      << sp->decomposition.sink() << "}\n";
+        } else {
+            out << "Empty SP decomposition (trivial).\n";
+        }
+    } else {
+        out << "The graph is NOT Series-Parallel.\n";
+        print_reason(result.reason(verdict::sp), out);
+    }
 
-    std::vector<edge_t> retval;
-    std::stack<std::pair<int, int>> dfs;
+    if (result.is_gsp) {
+        out << "The graph IS Generalized Series-Parallel.\n";
+    } else {
+        out << "The graph is NOT Generalized Series-Parallel.\n";
+        print_reason(result.reason(verdict::gsp), out);
+    }
 
-    dfs.emplace(root, 0);
-    dfs_no[root] = 1;
-    low[root] = 1;
-    parent[root] = -1;
-    int curr_dfs = 2;
-    bool root_cut = false;
+    if (result.is_outerplanar) {
+        out << "The graph IS Outerplanar.\n";
+    } else {
+        out << "The graph is NOT Outerplanar.\n";
+        print_reason(result.reason(verdict::outerplanar), out);
+    }
+    out << "\n=== Certificate Authentication ===\n";
+    if (!result.settled(verdict::sp)) {
+        err << "ERROR: No certificate generated\n";
+        return 1;
+    }
 
-    while (!dfs.empty()) {
-        std::pair<int, int> p = dfs.top();
-        int w = p.first;
-        int u = g.adjLists[p.first][p.second];
-        if (dfs_no[u] == 0) {
-            dfs.push(std::pair{u, 0});
-            parent[u] = w;
-            dfs_no[u] = curr_dfs++;
-            low[u] = dfs_no[u];
-            continue;
-        }
+    bool auth_ok = false;
+    try { 
+        auth_ok = result.authenticate(g); 
+    } catch(...) { 
+        auth_ok = false; 
+    }
 
-        if (parent[u] == w) {
-            if (low[u] >= dfs_no[w]) {
-                if (cut_verts[w] != -1) {
-                    if (w != root || root_cut) {
-                        if (!cert_out.reason) {
-                            N_LOG("NON-SP, three component cut vertex at " << w << "\n")
-                            std::shared_ptr<negative_cert_tri_comp_cut> cut{new negative_cert_tri_comp_cut{}};
-                            cut->v = w;
-                            cert_out.reason = cut;
-                            cert_out.is_sp = false;
-                        }
-                    } else {
-                        root_cut = true;
-                    }
-                } else {
-                    cut_verts[w] = retval.size();
+    if (!auth_ok) {
+        err << "ERROR: Certificate authentication failed!\n";
+        return 1;
+    }
+    
+    out << "Certificate authenticated successfully.\n";
+
+    if (!job.components.parts.empty()) {
+        sp_components<idx_t> const& comps = job.components;
+        auto yes_no = [](bool yes) {return yes ? "yes" : "no";};
+        out << "\n=== Connected Components ===\n";
+        out << comps.parts.size() << " component" << (comps.parts.size() == 1 ? "" : "s");
+        if (comps.isolated) out << " and " << comps.isolated << " isolated vert" << (comps.isolated == 1 ? "ex" : "ices");
+        out << ", largest first\n";
+        out << "Every component SP: " << yes_no(comps.all(verdict::sp))
+            << ", GSP: " << yes_no(comps.all(verdict::gsp))
+            << ", outerplanar: " << yes_no(comps.all(verdict::outerplanar)) << "\n";
+        for (size_t k = 0; k < comps.parts.size(); k++) {
+            auto const& p = comps.parts[k];
+            if (!p.authenticated) {
+                err << "ERROR: Certificate authentication failed for component " << k << "!\n";
+                return 1;
+            }
+            out << "Component " << k << ": " << p.verts.size() << " vertices, " << p.e << " edge" << (p.e == 1 ? "" : "s") << ", from vertex " << p.verts[0]
+                << ": SP " << yes_no(p.result.is_sp) << ", GSP " << yes_no(p.result.is_gsp)
+                << ", outerplanar " << yes_no(p.result.is_outerplanar) << "\n";
+            bool failed[3] = {!p.result.is_sp, !p.result.is_gsp, !p.result.is_outerplanar};
+            for (int v = 0; v < 3; v++) {
+                bool shown = false; // one certificate can settle several verdicts
+                for (int u = 0; u < v; u++) shown |= failed[u] && p.result.slot[u] == p.result.slot[v];
+                if (failed[v] && !shown) {
+                    out << "  ";
+                    print_reason(p.result.certs[p.result.slot[v]], out, &p.verts);
                 }
-                retval.emplace_back(w, u);
             }
-
-            if (low[u] < low[w]) low[w] = low[u];
-        } else if (dfs_no[u] < dfs_no[w] && u != parent[w]) {
-            if (dfs_no[u] < low[w]) low[w] = dfs_no[u];
         }
+        out << "Component certificates authenticated successfully.\n";
+    }
 
-        if ((size_t)(++dfs.top().second) >= g.adjLists[p.first].size()) {
-            dfs.pop();
+    if (opt.terminal_queries) {
+        out << "\n=== Two-Terminal Queries ===\n";
+        sp_terminal_pairs<idx_t> pairs;
+        pairs.build(result, g.n);
+        std::vector<char> yes = pairs.two_terminal(job.terminals, opt.threads);
+        for (size_t i = 0; i < yes.size(); i++) {
+            out << job.terminals[i].first << " " << job.terminals[i].second << (yes[i] ? " yes\n" : " no\n");
         }
     }
 
-    int n_bicomps = (int)(retval.size());
-    N_LOG(n_bicomps << " bicomp" << (n_bicomps == 1 ? "" : "s") << " found\n")
-    for (int i = 0; i < n_bicomps; i++) {
-        V_LOG("bicomp " << i << ": root " << retval[i].first << ", edge " << retval[i].second << "\n")
+    if (opt.insertion_queries) {
+        out << "\n=== Edge Insertion Queries ===\n";
+        sp_edge_insertion<idx_t> what_if;
+        what_if.build(g, opt.threads, &result);
+        std::vector<char> yes = what_if.insertable(job.insertions, true, opt.threads);
+        for (size_t i = 0; i < yes.size(); i++) {
+            out << job.insertions[i].first << " " << job.insertions[i].second << (yes[i] ? " yes\n" : " no\n");
+        }
     }
 
-    if (!root_cut) cut_verts[root] = -1;
-
-    retval.shrink_to_fit();
-    if (cert_out.reason) return retval;
-
-    N_LOG("no tri-comp-cut found\n")
-
-    std::vector<int> prev_cut((size_t)(n_bicomps), -1);
-    int root_one = -1;
-    int root_two = -1;
-
-    for (int i = 0; i < n_bicomps - 1; i++) {
-        int w = retval[i].first;
-        int u = -1;
-        int start = w;
-
-        while (w != root) {
-            u = w;
-            w = parent[w];
-            V_LOG("walking up tree for bicomp " << i << ", w: " << w << ", u: " << u <<"\n")
-
-            if (cut_verts[w] != -1 && u == retval[cut_verts[w]].second) {
-                V_LOG("found child bicomp: vertex " << start << " (bicomp " << i << ") child of vertex " << w << " (bicomp " << cut_verts[w] << ")\n")
-                if (prev_cut[cut_verts[w]] == -1) {
-                    prev_cut[cut_verts[w]] = start;
-                } else {
-                    std::shared_ptr<negative_cert_tri_cut_comp> cut{new negative_cert_tri_cut_comp{}};
-                    cut->c1 = w;
-                    cut->c2 = start;
-                    cut->c3 = prev_cut[cut_verts[w]];
-                    N_LOG("NON-SP, bicomp (not at root) with three cut vertices: " << cut->c1 << ", " << cut->c2 << ", " << cut->c3 << "\n")
-                    cert_out.reason = cut;
-                    cert_out.is_sp = false;
-                    return retval;
-                }
-                break;
-            }
+    if (opt.sp_subgraph) {
+        out << "\n=== Maximal SP Subgraph ===\n";
+        sp_subgraph<idx_t> sub;
+        sub.build(g, result, opt.threads);
+        if (!sub.save(opt.sp_subgraph)) {
+            err << "Error: could not write SP subgraph " << opt.sp_subgraph << "\n";
+            return 1;
         }
+        out << "Kept " << sub.edges.size() - sub.removed.size() << " of " << sub.edges.size() << " edges, written to " << opt.sp_subgraph << "\n";
+        out << "Removed " << sub.removed.size() << " edges, after " << sub.rechecks << " block rechecks over "
+            << sub.recheck_edges << " edges and " << sub.restored << " put back:\n";
+        for (idx_t k : sub.removed) out << sub.edges[k].first << " " << sub.edges[k].second << "\n";
+    }
 
-        if (w == root && (u == retval.back().second || u == -1)) {
-            V_LOG("found child bicomp of root: vertex " << start << " (bicomp " << i << ") child of vertex " << w << " (bicomp " << n_bicomps - 1 << ")\n")
-            if (root_one == -1) {
-                root_one = start;
-            } else if (root_two == -1) {
-                root_two = start;
+    if (opt.tree_decomposition || opt.block_cut) {
+        out << "\n=== Tree Decomposition ===\n";
+        if (opt.tree_decomposition) {
+            sp_tree_decomposition<idx_t> td;
+            if (!td.build(g, result, job.components)) {
+                out << "No width-2 tree decomposition (graph is not GSP).\n";
+            } else if (!td.save(opt.tree_decomposition)) {
+                err << "Error: could not write tree decomposition " << opt.tree_decomposition << "\n";
+                return 1;
             } else {
-                std::shared_ptr<negative_cert_tri_cut_comp> cut{new negative_cert_tri_cut_comp{}};
-                cut->c1 = root_one;
-                cut->c2 = root_two;
-                cut->c3 = start;
-                N_LOG("NON-SP, bicomp (at root) with three cut vertices: " << cut->c1 << ", " << cut->c2 << ", " << cut->c3 << "\n")
-                cert_out.reason = cut;
-                cert_out.is_sp = false;
-                return retval;
+                out << "Width " << td.largest - 1 << " with " << td.bags.size() << (td.bags.size() == 1 ? " bag" : " bags") << ", written to " << opt.tree_decomposition << "\n";
             }
         }
-    }
-
-    N_LOG("no tri-cut-comp found\n")
-
-    if (n_bicomps > 1) {
-        N_LOG("ordering bicomps as chain: ")
-        int second_endpoint = n_bicomps - 1;
-
-        for (int i = 1; i < n_bicomps - 1; i++) {
-            if (prev_cut[i] == -1) {
-                second_endpoint = i;
-                break;
+        if (opt.block_cut) {
+            sp_block_cut_tree<idx_t> bc;
+            bc.build(g);
+            if (!bc.save(opt.block_cut)) {
+                err << "Error: could not write block-cut tree " << opt.block_cut << "\n";
+                return 1;
             }
+            out << "Block-cut tree with " << bc.blocks.size() << (bc.blocks.size() == 1 ? " block and " : " blocks and ")
+                << bc.cut_vertex.size() << (bc.cut_vertex.size() == 1 ? " cut vertex" : " cut vertices") << ", written to " << opt.block_cut << "\n";
         }
+    }
 
-        N_LOG("bicomp " << second_endpoint << " is the other bicomp with no child\n")
+    if (opt.mwis || opt.spanning_trees) {
+        out << "\n=== Dynamic Programming ===\n";
+        sp_tree<idx_t> const * t = result.decomposition();
+        if (!t) {
+            out << "No decomposition tree (graph is not GSP).\n";
+            return 0;
+        }
 
-        std::reverse(retval.begin() + second_endpoint, retval.end() - 1);
-        if (second_endpoint != n_bicomps - 1) {
-            retval.back().second = retval[n_bicomps - 2].first;
-            retval.back().first = retval[n_bicomps - 2].second;
-        } else {
-            if (retval.back().first == retval[n_bicomps - 2].first) {
-                retval.back().first = retval.back().second;
-            } else {
-                retval.back().first = parent[retval[n_bicomps - 2].first];
-            }
-            retval.back().second = retval[n_bicomps - 2].first;
+        if (opt.mwis) {
+            out << "Maximum weight independent set: " << sp_max_weight_independent_set(*t, g, {}, opt.threads) << "\n";
         }
+        if (opt.spanning_trees) {
+            out << "Spanning trees: ";
+            print_spanning_tree_count(*t, g, opt.threads, out);
+            out << "\n";
+        }
+    }
 
-        for (int i = second_endpoint; i < n_bicomps - 1; i++) {
-            retval[i].second = parent[retval[i].first];
+    if (opt.distance_queries || opt.save_oracle) {
+        out << "\n=== Distance Oracle ===\n";
+        sp_tree<idx_t> const * t = result.decomposition();
+        if (!t) {
+            out << "No decomposition tree (graph is not GSP).\n";
+            return 0;
         }
 
-        #ifdef __VERBOSE_LOGGING__
-            for (int i = 0; i < n_bicomps; i++) {
-                V_LOG("bicomp " << i << " after reordering: root " << retval[i].first << ", edge " << retval[i].second << "\n")
-            }
-        #endif
+        sp_distance_oracle<idx_t> oracle;
+        oracle.build(*t, g);
+        if (opt.save_oracle && !oracle.save(opt.save_oracle)) {
+            err << "Error: could not write distance oracle " << opt.save_oracle << "\n";
+            return 1;
+        }
+        if (opt.distance_queries) print_distances(job.queries, oracle.distances(job.queries, opt.threads), out);
     }
 
-    return retval;
+    return 0;
 }
 
-sp_result SP_RECOGNITION(graph const& g) {
-    sp_result retval{};
-
-    std::vector<int> cut_verts(g.n, -1);
-    std::vector<edge_t> bicomps = get_bicomps(g, cut_verts, retval);
-    int n_bicomps = (int)(bicomps.size());
-    std::vector<sp_tree> cut_vertex_attached_tree((size_t)(n_bicomps));
-    std::vector<int> comp(g.n, -1);
-
-    std::vector<std::stack<sp_chain_stack_entry>> vertex_stacks((size_t)(g.n));
-    std::vector<int> dfs_no((size_t)(g.n + 1), 0);
-    std::vector<int> parent((size_t)(g.n), 0);
+// an input file read into memory by input_reader
+struct read_input {
+    size_t seq;
+    const char * input;
+    std::unique_ptr<char[]> data;
+    size_t size = 0;
+    int error = 0; // errno of a failed open or read
+};
 
-    std::vector<edge_t> ear((size_t)(g.n), edge_t{g.n, g.n});
-    std::vector<sp_tree> seq((size_t)(g.n));
-    std::vector<int> earliest_outgoing((size_t)(g.n), g.n);
+#ifdef __IO_URING__
+// a submission and a completion ring of the kernel, set up with the bare
+// system calls
+struct io_ring {
+    int fd = -1;
+    unsigned entries = 0;
+    void * sq_map = nullptr;
+    void * cq_map = nullptr;
+    size_t sq_len = 0;
+    size_t cq_len = 0;
+    io_uring_sqe * sqes = nullptr;
+    io_uring_cqe * cqes = nullptr;
+    unsigned * sq_tail = nullptr;
+    unsigned * sq_mask = nullptr;
+    unsigned * sq_array = nullptr;
+    unsigned * cq_head = nullptr;
+    unsigned * cq_tail = nullptr;
+    unsigned * cq_mask = nullptr;
+    unsigned queued = 0; // entries filled in since the last enter()
+
+    io_ring() = default;
+    io_ring(io_ring const& other) = delete;
+    io_ring& operator=(io_ring const& other) = delete;
+
+    ~io_ring() {
+        if (sqes) munmap(sqes, entries * sizeof(io_uring_sqe));
+        if (cq_map && cq_map != sq_map) munmap(cq_map, cq_len);
+        if (sq_map) munmap(sq_map, sq_len);
+        if (fd >= 0) close(fd);
+    }
 
-    std::vector<char> num_children((size_t)(g.n), 0);
-    std::vector<int> alert((size_t)(g.n), -1);
+    // false where the kernel has no io_uring or does not let us use it
+    bool open(unsigned depth) {
+        io_uring_params p;
+        std::memset(&p, 0, sizeof(p));
+        fd = (int)(syscall(__NR_io_uring_setup, depth, &p));
+        if (fd < 0) return false;
+        entries = p.sq_entries;
+
+        sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+        cq_len = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+        bool single = (p.features & IORING_FEAT_SINGLE_MMAP);
+        if (single) sq_len = cq_len = std::max(sq_len, cq_len);
+
+        void * addr = mmap(nullptr, sq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+        if (addr == MAP_FAILED) return false;
+        sq_map = addr;
+        if (single) {
+            cq_map = sq_map;
+        } else {
+            addr = mmap(nullptr, cq_len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+            if (addr == MAP_FAILED) return false;
+            cq_map = addr;
+        }
+        addr = mmap(nullptr, entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+        if (addr == MAP_FAILED) return false;
+        sqes = static_cast<io_uring_sqe *>(addr);
+
+        char * sq = static_cast<char *>(sq_map);
+        char * cq = static_cast<char *>(cq_map);
+        sq_tail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+        sq_mask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+        sq_array = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+        cq_head = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+        cq_tail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+        cq_mask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+        cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+        return true;
+    }
 
-    std::stack<std::pair<int, int>> dfs;
+    // queues a read of iov at offset; the caller keeps at most entries reads
+    // outstanding, so there is always room
+    void readv(int file, iovec const * iov, uint64_t offset, uint64_t tag) {
+        unsigned tail = *sq_tail;
+        unsigned at = tail & *sq_mask;
+        io_uring_sqe& sqe = sqes[at];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_READV;
+        sqe.fd = file;
+        sqe.addr = (uint64_t)(uintptr_t)(iov);
+        sqe.len = 1;
+        sqe.off = offset;
+        sqe.user_data = tag;
+        sq_array[at] = at;
+        __atomic_store_n(sq_tail, tail + 1, __ATOMIC_RELEASE);
+        queued++;
+    }
 
-    dfs_no[g.n] = g.n;
+    // submits what was queued and waits for at least one completion
+    bool enter() {
+        while (syscall(__NR_io_uring_enter, fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0) {
+            if (errno != EINTR) return false;
+        }
+        queued = 0;
+        return true;
+    }
 
-    bool do_k23_edge_replacement = true;
+    // fn(tag, result) on each completion that has arrived
+    template <typename F>
+    void reap(F const& fn) {
+        unsigned head = *cq_head;
+        unsigned tail = __atomic_load_n(cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; head++) {
+            io_uring_cqe const& cqe = cqes[head & *cq_mask];
+            fn(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head, head, __ATOMIC_RELEASE);
+    }
+};
+#endif
 
-    for (int bicomp = 0; bicomp < n_bicomps; bicomp++) {
-        N_LOG("BICOMP " << bicomp << "\n")
+// reads the batch's input files whole into memory, ahead of the loaders: up
+// to depth files have reads outstanding at once through io_uring, and each
+// file is handed to out as soon as its last read completes. without
+// io_uring the files are read one after the other with pread
+struct input_reader {
+    static constexpr size_t max_read = (size_t)(1) << 30; // 1 GiB per read, below the kernel limit of about 2 GB
+
+    std::vector<const char *> const& inputs;
+    bounded_queue<std::unique_ptr<read_input>>& out;
+    unsigned depth;
+
+    // opens the file and sizes its buffer; false if the file is done
+    // already: it failed (with error set), or it was a stream, read whole
+    bool start(read_input& file, int& fd) {
+        fd = ::open(file.input, O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            file.error = errno;
+            if (fd >= 0) close(fd);
+            return false;
+        }
+        if (!S_ISREG(st.st_mode)) {
+            if (!read_stream(fd, file.data, file.size)) file.error = errno;
+            close(fd);
+            return false;
+        }
+        file.size = (size_t)(st.st_size);
+        file.data.reset(new char[file.size + 1]);
+        return true;
+    }
 
-        int root = bicomps[bicomp].first;
-        int next;
-        if (!retval.reason && bicomp > 0 && bicomp < n_bicomps - 1) {
-            next = bicomps[bicomp - 1].first;
-        } else {
-            next = bicomps[bicomp].second;
+    void read_all(read_input& file, int fd) {
+        size_t done = 0;
+        while (done < file.size) {
+            ssize_t got = pread(fd, file.data.get() + done, std::min(file.size - done, max_read), (off_t)(done));
+            if (got < 0 && errno == EINTR) continue;
+            if (got < 0) {
+                file.error = errno;
+                break;
+            }
+            if (got == 0) break;
+            done += (size_t)(got);
         }
+        file.size = done;
+    }
 
-        dfs.emplace(root, -1);
-        dfs.emplace(next, 0);
+    std::unique_ptr<read_input> make(size_t k) {
+        std::unique_ptr<read_input> file{new read_input{}};
+        file->seq = k;
+        file->input = inputs[k];
+        return file;
+    }
 
-        bool fake_edge = false;
-        if (!retval.reason) {
-            fake_edge = true;
-            for (int u1 : g.adjLists[next]) {
-                if (u1 == root) {
-                    fake_edge = false;
-                    break;
-                }
+    void run_pread(size_t from) {
+        for (size_t k = from; k < inputs.size(); k++) {
+            std::unique_ptr<read_input> file = make(k);
+            int fd;
+            if (start(*file, fd)) {
+                read_all(*file, fd);
+                close(fd);
             }
+            out.push(std::move(file));
         }
-                dfs_no[root] = 1;
-        parent[root] = -1;
-        dfs_no[next] = 2;
-        parent[next] = root;
-        comp[next] = bicomp;
-        int curr_dfs = 3;
+        N_LOG("read " << inputs.size() - from << " input files with pread\n")
+    }
 
-        while (!dfs.empty()) {
-            std::pair<int, int> p = dfs.top();
-            int v = parent[p.first];
-            int w = p.first;
-            int u = g.adjLists[p.first][p.second];
-
-            if (comp[u] == -1 || comp[u] == bicomp) {
-                V_LOG("v: " << v << " w: " << w << " u: " << u << "\n")
-                V_LOG("seq_w: " << seq[w] << ", seq_u: " << seq[u] << "\n")
-                if (dfs_no[u] == 0) {
-                    dfs.push(std::pair{u, 0});
-                    parent[u] = w;
-                    dfs_no[u] = curr_dfs++;
-                    comp[u] = bicomp;
-                    num_children[w]++;
+    void run() {
+        #ifdef __IO_URING__
+        io_ring ring;
+        if (ring.open(depth)) {
+            run_ring(ring);
+            return;
+        }
+        #endif
+        run_pread(0);
+    }
+
+    #ifdef __IO_URING__
+    // a file with a read in flight
+    struct slot {
+        std::unique_ptr<read_input> file;
+        int fd = -1;
+        size_t done = 0;
+        iovec iov;
+    };
+
+    void run_ring(io_ring& ring) {
+        std::vector<slot> slots(std::min<size_t>(depth, ring.entries));
+        std::vector<size_t> idle;
+        for (size_t t = slots.size(); t-- > 0; ) idle.push_back(t);
+
+        auto submit = [&](size_t t) {
+            slot& s = slots[t];
+            s.iov.iov_base = s.file->data.get() + s.done;
+            s.iov.iov_len = std::min(s.file->size - s.done, max_read);
+            ring.readv(s.fd, &s.iov, s.done, t);
+        };
+
+        auto finish = [&](size_t t) {
+            slot& s = slots[t];
+            close(s.fd);
+            s.file->size = s.done;
+            out.push(std::move(s.file));
+            s = slot{};
+            idle.push_back(t);
+        };
+
+        size_t next = 0;
+        while (next < inputs.size() || idle.size() < slots.size()) {
+            while (!idle.empty() && next < inputs.size()) {
+                std::unique_ptr<read_input> file = make(next++);
+                int fd;
+                if (!start(*file, fd)) {
+                    out.push(std::move(file));
                     continue;
                 }
-
-                bool child_back_edge = (dfs_no[u] < dfs_no[w] && u != v);
-                #ifdef __LOGGING__
-                    if (child_back_edge) N_LOG("BACK EDGE (" << w << ", " << u << ")\n")
-                #endif
-
-                if (parent[u] == w) {
-                    N_LOG("tree edge (" << w << ", " << u << ")\n")
-                    // --- update-seq in the paper begins here ---
-                    for (; !vertex_stacks[w].empty(); vertex_stacks[w].pop()) {
-                        if (seq[u].source() != vertex_stacks[w].top().end) {
-                            N_LOG("OOPS, 3.4b due to POPPING STACK child seq " << seq[u] << " parent seq " << seq[w] << "\n")
-                            std::shared_ptr<negative_cert_K4> k4{new negative_cert_K4{}};
-
-                            k4->b = seq[u].source();
-                            k4->a = vertex_stacks[w].top().end;
-                            k4->c = w;
-                            edge_t holding_ear = ear[u];
-
-                            for (int a = k4->a; a != k4->b; a = parent[a]) k4->ab.emplace_back(a, parent[a]);
-                            for (int b = k4->b; b != k4->c; b = parent[b]) k4->bc.emplace_back(b, parent[b]);
-
-                            k4->d = -1;
-                            int c = k4->c;
-                            while (k4->d == -1) {
-                                k4->cd.emplace_back(c, parent[c]);
-                                c = parent[c];
-
-                                for (; !vertex_stacks[c].empty(); vertex_stacks[c].pop()) {
-                                    if (vertex_stacks[c].top().end == k4->b) {
-                                        k4->d = c;
-                                        break;
-                                    }
-                                }
-                            }
-
-                            for (int d = k4->d; d != holding_ear.second; d = parent[d]) k4->ad.emplace_back(d, parent[d]);
-                            k4->ad.emplace_back(holding_ear.second, holding_ear.first);
-                            for (int d = holding_ear.first; d != k4->a; d = parent[d]) k4->ad.emplace_back(d, parent[d]);
-
-                            int ear1 = vertex_stacks[k4->d].top().SP.underlying_tree_path_source();
-                            k4->bd.emplace_back(k4->d, ear1);
-                            for (; ear1 != k4->b; ear1 = parent[ear1]) k4->bd.emplace_back(ear1, parent[ear1]);
-                            int ear2 = vertex_stacks[k4->c].top().SP.underlying_tree_path_source();
-                            k4->ac.emplace_back(k4->c, ear2);
-                            for (; ear2 != k4->a; ear2 = parent[ear2]) k4->ac.emplace_back(ear2, parent[ear2]);
-
-                            retval.reason = k4;
-                            break;
-                        }
-
-                        seq[u].compose(std::move(vertex_stacks[w].top().SP), c_type::antiparallel);
-                        seq[u].l_compose(std::move(vertex_stacks[w].top().tail), c_type::series);
-                    }
-                    // ---- update-seq in the paper ends here ----
-
-                    if (retval.reason) break;
+                if (file->size == 0) {
+                    close(fd);
+                    out.push(std::move(file));
+                    continue;
                 }
 
-                if (parent[u] == w || child_back_edge) {
-                    // ---- update-ear-of-parent in the paper begins here ----
-                    edge_t ear_f = (child_back_edge ? edge_t{w, u} : ear[u]);
-                    sp_tree seq_u = (child_back_edge ? sp_tree{u, w} : std::move(seq[u]));
-
-                    if (dfs_no[ear_f.second] < dfs_no[ear[w].second]) {
-                        if (ear[w].first != g.n) {
-                            if (!retval.reason && ear[w].first != w) K23_test(retval.reason, alert, parent, ear[w], ear_f, w);
-                            if (seq[w].source() != ear[w].second) {
-                                N_LOG("OOPS, 3.4a due to CASE B prev winner " << seq[w] << " prev winner ear (" << ear[w].first << ", " << ear[w].second << ")\n")
-                                report_K4_non_stack_pop_case(retval, parent, vertex_stacks, seq[w].source(), w, ear[w].second, ear[w].first, ear_f.second, ear_f.first);
-                                break;
-                            }
-
-                            N_LOG("CASE B (ear exists): placed " << seq[w] << " onto stk " << ear[w].second << "\n")
-                            vertex_stacks[ear[w].second].emplace(std::move(seq[w]), w, sp_tree{});
-                            earliest_outgoing[w] = ear[w].second;
-                        }
-                        ear[w] = ear_f;
-                        seq[w] = std::move(seq_u);
-                        N_LOG("CASE B (replace seq): current winning seq " << seq[w] << "\n")
-                    } else {
-                        if (seq_u.source() != ear_f.second) {
-                            N_LOG("OOPS, 3.4a/b due to CASE A/C child seq " << seq_u << " child ear (" << ear_f.first << ", " << ear_f.second << ")\n")
-                            report_K4_non_stack_pop_case(retval, parent, vertex_stacks, seq_u.source(), w, ear_f.second, ear_f.first, ear[w].second, ear[w].first);
-                            break;
-                        }
-
-                        if (dfs_no[ear_f.second] == dfs_no[ear[w].second]) {
-                            if (!retval.reason && !child_back_edge && ear[w].first != w) K23_test(retval.reason, alert, parent, ear_f, ear[w], w);
-
-                            if (seq[w].source() != ear[w].second) {
-                                N_LOG("OOPS, 3.4a/b due to CASE C parent seq " << seq[w] << " parent ear (" << ear[w].first << ", " << ear[w].second << ")\n")
-                                report_K4_non_stack_pop_case(retval, parent, vertex_stacks, seq[w].source(), w, ear[w].second, ear[w].first, ear_f.second, ear_f.first);
-                                break;
-                            }
-                            seq[w].compose(std::move(seq_u), c_type::parallel);
-                            N_LOG("CASE C: current winning seq after merge " << seq[w] << "\n")
-
-                            if ((ear[w].first == w || dfs_no[ear_f.first] < dfs_no[ear[w].first]) && ear_f.first != w) {
-                                ear[w] = ear_f;
-                            }
-                        } else {
-                            if (!retval.reason && !child_back_edge) K23_test(retval.reason, alert, parent, ear_f, ear[w], w);
-
-                            if (!vertex_stacks[ear_f.second].empty() && vertex_stacks[ear_f.second].top().end == w) {
-                                N_LOG("CASE A (merge onto existing stack entry for stk " << ear_f.second << "): current child seq before merge " << seq_u << "\n")
-                                vertex_stacks[ear_f.second].top().SP.compose(std::move(seq_u), c_type::parallel);
-                            } else {
-                                N_LOG("CASE A (new stack entry): placed " << seq_u << " onto stk " << ear_f.second << " (earliest outgoing " << earliest_outgoing[w] << ")\n")
-                                vertex_stacks[ear_f.second].emplace(std::move(seq_u), w, sp_tree{});
-                                if (dfs_no[ear_f.second] < dfs_no[earliest_outgoing[w]]) {
-                                    earliest_outgoing[w] = ear_f.second;
-                                }
-                            }
-                        }
-                    }
-                    // ----- update-ear-of-parent in the paper ends here -----
+                size_t t = idle.back();
+                idle.pop_back();
+                slots[t].file = std::move(file);
+                slots[t].fd = fd;
+                submit(t);
+            }
+            if (idle.size() == slots.size()) continue;
+
+            if (!ring.enter()) {
+                // the ring broke down: the files in flight are read again
+                // plainly, and so are the rest
+                for (slot& s : slots) {
+                    if (!s.file) continue;
+                    read_all(*s.file, s.fd);
+                    close(s.fd);
+                    out.push(std::move(s.file));
                 }
+                run_pread(next);
+                return;
             }
 
-            if ((size_t)(++dfs.top().second) >= g.adjLists[p.first].size()) {
-                if (w != root) {
-                    if (earliest_outgoing[w] != g.n) {
-                        N_LOG("EARLIEST OUTGOING " << earliest_outgoing[w] << ": moved current winning seq " << seq[w] << " to vertex stack entry tail with SP " << vertex_stacks[earliest_outgoing[w]].top().SP << "\n")
-                        vertex_stacks[earliest_outgoing[w]].top().tail = std::move(seq[w]);
-                    }
-
-                    if (v == root) {
-                        seq[w].compose((fake_edge ? sp_tree{} : sp_tree{v, w}), c_type::parallel);
-
-                        if (cut_verts[w] != -1) {
-                            seq[w].compose(std::move(cut_vertex_attached_tree[cut_verts[w]]), c_type::series);
-                        }
-                        break;
-
-                    } else {
-                        if (cut_verts[w] != -1) {
-                            cut_vertex_attached_tree[cut_verts[w]].l_compose(sp_tree{w, v}, c_type::dangling);
-                                                        seq[w].compose(std::move(cut_vertex_attached_tree[cut_verts[w]]), c_type::series);
-                        } else {
-                            seq[w].compose(sp_tree{w, v}, c_type::series);
-                        }
+            std::vector<size_t> done;
+            ring.reap([&](uint64_t t, int res) {
+                slot& s = slots[t];
+                if (res < 0) {
+                    s.file->error = -res;
+                } else if (res > 0) {
+                    s.done += (size_t)(res);
+                    if (s.done < s.file->size) {
+                        submit(t);
+                        return;
                     }
                 }
-
-                dfs.pop();
-            }
+                done.push_back(t);
+            });
+            for (size_t t : done) finish(t);
         }
+        N_LOG("read " << inputs.size() << " input files through io_uring, " << slots.size() << " at a time\n")
+    }
+    #endif
+};
 
-        dfs_no[root] = 0;
+// one input file on its way through the batch pipeline
+struct batch_item {
+    size_t seq;
+    const char * input;
+    std::unique_ptr<sp_job<int32_t>> narrow; // at most one of these is set,
+    std::unique_ptr<sp_job<int64_t>> wide; // none if loading failed
+    std::ostringstream out;
+    std::ostringstream err;
+    int status = 0;
+    bool keyed = false; // key is set, and the report is to be cached
+    graph_key key;
+
+    template <typename F>
+    void with_job(F&& fn) {
+        if (narrow) fn(*narrow);
+        else if (wide) fn(*wide);
+    }
+};
 
-        if (!retval.reason) {
-            N_LOG("no K23 found\n")
+// runs every input through three stages, loading, recognition and
+// authentication with the report, each on its own threads and joined by
+// queues of batch_queue_depth graphs, so that graph k + 1 is parsed while
+// graph k is recognized and graph k - 1 authenticated. the queues hold back
+// the loaders when the later stages fall behind, so at most the graphs in
+// the queues and on the stage threads are in memory. reports are printed in
+// input order. ahead of the loaders, an input_reader keeps opt.read_depth
+// files being read, and as many more read and waiting
+int run_batch(options const& opt) {
+    static const size_t batch_queue_depth = 2;
+    bounded_queue<std::unique_ptr<read_input>> read{(size_t)(opt.read_depth)};
+    bounded_queue<std::unique_ptr<batch_item>> loaded{batch_queue_depth};
+    bounded_queue<std::unique_ptr<batch_item>> recognized{batch_queue_depth};
+    std::unique_ptr<result_cache> cache{opt.cacheable() ? new result_cache{opt.cache_dir, opt.cache_limit} : nullptr};
+
+    std::mutex print_lock;
+    std::map<size_t, std::unique_ptr<batch_item>> finished;
+    size_t next_print = 0;
+    int status = 0;
+
+    auto load = [&]() {
+        std::unique_ptr<read_input> infile;
+        while (read.pop(infile)) {
+            std::unique_ptr<batch_item> item{new batch_item{}};
+            std::string report;
+            item->seq = infile->seq;
+            item->input = infile->input;
+
+            graph_header header;
+            graph_text text;
+            std::string why;
+            if (infile->error) {
+                item->err << "Error: could not open file " << item->input << "\n";
+            } else if (!open_graph_text(infile->data.get(), infile->data.get() + infile->size, text, header, why)) {
+                item->err << "Error: " << why << "\n";
+            } else if (cache && (item->keyed = hash_graph(text, header, opt.certify, item->key)) && cache->lookup(item->key, report)) {
+                print_cached(item->key, report, item->out);
+                item->keyed = false;
+                loaded.push(std::move(item));
+                continue;
+            } else if (header.wide()) {
+                item->wide.reset(new sp_job<int64_t>{});
+                item->wide->input = item->input;
+                if (!load_job(opt, *item->wide, text, header, item->out, item->err)) item->wide.reset();
+            } else {
+                item->narrow.reset(new sp_job<int32_t>{});
+                item->narrow->input = item->input;
+                if (!load_job(opt, *item->narrow, text, header, item->out, item->err)) item->narrow.reset();
+            }
+            if (!item->narrow && !item->wide) item->status = 1;
+            infile.reset();
+            loaded.push(std::move(item));
         }
+    };
 
-        if (fake_edge) {
-            edge_t fake = edge_t{root, next};
-
-            if (retval.reason) {
-                std::shared_ptr<negative_cert_K4> k4 = std::dynamic_pointer_cast<negative_cert_K4>(retval.reason);
-                if (k4) {
-                    std::vector<edge_t> * k4_paths[6] = {&k4->ab, &k4->ac, &k4->ad, &k4->bc, &k4->bd, &k4->cd};
-                    int k4_verts[4] = {k4->a, k4->b, k4->c, k4->d};
-                    static const int k4_t4_translation[6][5] = {{1, 3, 2, 4, 5}, {0, 3, 2, 5, 4}, {0, 4, 1, 5, 3}, {0, 1, 4, 5, 2}, {0, 2, 3, 5, 1}, {1, 2, 3, 4, 0}};
-                    static const int k4_t4_endpoint_translation[6][4] = {{0, 1, 2, 3}, {0, 2, 1, 3}, {0, 3, 1, 2}, {1, 2, 0, 3}, {1, 3, 0, 2}, {2, 3, 0, 1}};
-
-                    int pnum = 0;
-                    for (; pnum < 6; pnum++) {
-                        if (path_contains_edge(*(k4_paths[pnum]), fake) != -1) break;
-                    }
-
-                    if (pnum != 6) {
-                        N_LOG("FAKE EDGE IN K4 (pnum " << pnum << "), GENERATE T4\n")
-                        std::shared_ptr<negative_cert_T4> t4{new negative_cert_T4{}};
-
-                        t4->c1a = std::move(*(k4_paths[k4_t4_translation[pnum][0]]));
-                        t4->c2a = std::move(*(k4_paths[k4_t4_translation[pnum][1]]));
-                        t4->c1b = std::move(*(k4_paths[k4_t4_translation[pnum][2]]));
-                        t4->c2b = std::move(*(k4_paths[k4_t4_translation[pnum][3]]));
-                        t4->ab = std::move(*(k4_paths[k4_t4_translation[pnum][4]]));
-                        t4->c1 = k4_verts[k4_t4_endpoint_translation[pnum][0]];
-                        t4->c2 = k4_verts[k4_t4_endpoint_translation[pnum][1]];
-                        t4->a = k4_verts[k4_t4_endpoint_translation[pnum][2]];
-                        t4->b = k4_verts[k4_t4_endpoint_translation[pnum][3]];
-
-                        retval.reason = t4;
-
-                        for (int i = 0; i < g.n; i++) {
-                            if (comp[i] == bicomp) {
-                                dfs_no[i] = 0;
-                                parent[i] = 0;
-                                ear[i] = edge_t{g.n, g.n};
-                                num_children[i] = 0;
-                                alert[i] = -1;
-                                earliest_outgoing[i] = g.n;
-                                seq[i] = sp_tree{};
-                                vertex_stacks[i] = std::stack<sp_chain_stack_entry>{};
-                            }
-                        }
-
-                        bicomp--;
-                    }
-                }
+    auto recognize = [&]() {
+        std::unique_ptr<batch_item> item;
+        while (loaded.pop(item)) {
+            item->with_job([&](auto& job) {recognize_job(opt, job);});
+            recognized.push(std::move(item));
+        }
+    };
+
+    auto report = [&]() {
+        std::unique_ptr<batch_item> item;
+        while (recognized.pop(item)) {
+            std::ostringstream report;
+            bool keep = false;
+            item->with_job([&](auto& job) {
+                item->status = report_job(opt, job, report, item->err);
+                keep = witnessed(job);
+            });
+            item->out << report.str();
+            if (item->keyed && keep && item->status == 0) cache->store(item->key, report.str());
+            item->narrow.reset();
+            item->wide.reset();
+
+            std::lock_guard<std::mutex> guard{print_lock};
+            finished[item->seq] = std::move(item);
+            for (auto it = finished.begin(); it != finished.end() && it->first == next_print; it = finished.erase(it), next_print++) {
+                batch_item const& done = *it->second;
+                std::cout << "=== " << done.input << " ===\n" << done.out.str() << "\n" << std::flush;
+                std::cerr << done.err.str() << std::flush;
+                status = std::max(status, done.status);
             }
+        }
+    };
+
+    // each stage closes its output queue once all of its threads are done
+    auto stage = [](int threads, auto const& work, std::function<void()> done) {
+        return std::thread{[threads, work, done]() {
+            std::vector<std::thread> pool;
+            for (int t = 0; t < threads; t++) pool.emplace_back(work);
+            for (std::thread& th : pool) th.join();
+            done();
+        }};
+    };
+
+    std::thread reader{[&]() {
+        input_reader{opt.inputs, read, (unsigned)(opt.read_depth)}.run();
+        read.close();
+    }};
+    std::thread loaders = stage(opt.stage_threads[0], load, [&]() {loaded.close();});
+    std::thread recognizers = stage(opt.stage_threads[1], recognize, [&]() {recognized.close();});
+    std::thread reporters = stage(opt.stage_threads[2], report, []() {});
+    reader.join();
+    loaders.join();
+    recognizers.join();
+    reporters.join();
+    return status;
+}
 
-            if (retval.reason && do_k23_edge_replacement) {
-                std::shared_ptr<negative_cert_K23> k23 = std::dynamic_pointer_cast<negative_cert_K23>(retval.reason);
-                if (k23) {
-                    std::vector<edge_t> * k23_paths[3] = {&k23->one, &k23->two, &k23->three};
-
-                    int pnum = 0;
-                    int path_ind;
-                    for (; pnum < 3; pnum++) {
-                        path_ind = path_contains_edge(*(k23_paths[pnum]), fake);
-                        if (path_ind != -1) break;
-                    }
-
-                    if (pnum != 3) {
-                        std::vector<edge_t>& violating_path = *(k23_paths[pnum]);
-                        N_LOG("FAKE EDGE IN K23 (" << violating_path[path_ind].first << ", " << violating_path[path_ind].second << "), REPLACE WITH PATH\n")
-
-                        std::vector<edge_t> splice_path;
-                        std::vector<bool> in_k23(g.n, false);
+// everything after the header, with indices of type idx_t
+template <typename idx_t>
+int run(options const& opt, graph_text const& text, graph_header const& header) {
+    std::unique_ptr<result_cache> cache;
+    graph_key key;
+    if (opt.cacheable() && hash_graph(text, header, opt.certify, key)) {
+        cache.reset(new result_cache{opt.cache_dir, opt.cache_limit});
+        std::string report;
+        if (cache->lookup(key, report)) {
+            print_cached(key, report, std::cout);
+            return 0;
+        }
+    }
 
-                        for (std::vector<edge_t> * path : k23_paths) {
-                            for (edge_t e : *path) {
-                                in_k23[e.first] = true;
-                                in_k23[e.second] = true;
-                                V_LOG("(" << e.first << ", " << e.second << ") in K23\n")
-                            }
-                        }
+    sp_job<idx_t> job;
+    job.input = opt.input;
+    if (!load_job(opt, job, text, header, std::cout, std::cerr)) return 1;
+    recognize_job(opt, job);
+    if (!cache) return report_job(opt, job, std::cout, std::cerr);
+
+    std::ostringstream report;
+    int status = report_job(opt, job, report, std::cerr);
+    std::cout << report.str();
+    if (status == 0 && witnessed(job)) cache->store(key, report.str());
+    return status;
+}
 
-                        for (int u2 : g.adjLists[next]) {
-                            if (comp[u2] == bicomp && parent[u2] == next && !in_k23[u2]) {
-                                V_LOG("FOUND TREE CHILD OF NEXT " << next << " NOT IN K23: " << u2 << ", ear (" << ear[u2].first << ", " << ear[u2].second << ")\n")
-                                splice_path.emplace_back(ear[u2].first, root);
-                                for (int i = ear[u2].first; i != next; i = parent[i]) splice_path.emplace_back(parent[i], i);
-                                break;
-                            }
-                        }
 
-                        std::reverse(splice_path.begin(), splice_path.end());
-                        violating_path.erase(violating_path.begin() + path_ind);
-                        violating_path.insert(violating_path.begin() + path_ind, splice_path.begin(), splice_path.end());
-                    }
-                }
-            }
+int main(int argc, char* argv[]) {
+    options opt;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--mwis") {
+            opt.mwis = true;
+        } else if (arg == "--spanning-trees") {
+            opt.spanning_trees = true;
+        } else if (arg == "--threads" && i + 1 < argc) {
+            opt.threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--distances" && i + 1 < argc) {
+            opt.distance_queries = argv[++i];
+        } else if (arg == "--terminals" && i + 1 < argc) {
+            opt.terminal_queries = argv[++i];
+        } else if (arg == "--insertions" && i + 1 < argc) {
+            opt.insertion_queries = argv[++i];
+        } else if (arg == "--certify") {
+            opt.certify = true;
+        } else if (arg == "--fused") {
+            opt.fused = true;
+        } else if (arg == "--sp-subgraph" && i + 1 < argc) {
+            opt.sp_subgraph = argv[++i];
+        } else if (arg == "--td" && i + 1 < argc) {
+            opt.tree_decomposition = argv[++i];
+        } else if (arg == "--block-cut" && i + 1 < argc) {
+            opt.block_cut = argv[++i];
+        } else if (arg == "--save-oracle" && i + 1 < argc) {
+            opt.save_oracle = argv[++i];
+        } else if (arg == "--oracle" && i + 1 < argc) {
+            opt.oracle_file = argv[++i];
+        } else if (arg == "--packed") {
+            opt.packed = true;
+        } else if (arg == "--external" && i + 1 < argc) {
+            opt.external = argv[++i];
+        } else if (arg == "--ram-budget" && i + 1 < argc) {
+            opt.ram_budget = (size_t)(std::max(1L, std::atol(argv[++i]))) << 20;
+        } else if (arg == "--cache" && i + 1 < argc) {
+            opt.cache_dir = argv[++i];
+        } else if (arg == "--cache-limit" && i + 1 < argc) {
+            opt.cache_limit = (size_t)(std::max(0L, std::atol(argv[++i]))) << 20;
+        } else if (arg == "--scaling" && i + 1 < argc) {
+            opt.scaling = argv[++i];
+        } else if (arg == "--scaling-max" && i + 1 < argc) {
+            opt.scaling_max = std::max(1024L, std::atol(argv[++i]));
+        } else if (arg == "--read-depth" && i + 1 < argc) {
+            opt.read_depth = std::max(1, std::min(4096, std::atoi(argv[++i])));
+        } else if (arg == "--trace" && i + 1 < argc) {
+            opt.trace = argv[++i];
+        } else if (arg == "--trace-level" && i + 1 < argc) {
+            opt.trace_level = std::max(1, std::min(2, std::atoi(argv[++i])));
+        } else if (arg == "--trace-buffer" && i + 1 < argc) {
+            opt.trace_buffer = (size_t)(std::max(1L, std::atol(argv[++i]))) << 20;
+        } else if (arg == "--trace-json" && i + 2 < argc) {
+            opt.trace_json[0] = argv[++i];
+            opt.trace_json[1] = argv[++i];
+        } else if (arg == "--stages" && i + 1 < argc) {
+            std::istringstream is{argv[++i]};
+            char sep;
+            is >> opt.stage_threads[0] >> sep >> opt.stage_threads[1] >> sep >> opt.stage_threads[2];
+            for (int& t : opt.stage_threads) t = std::max(1, t);
+        } else if (arg[0] != '-') {
+            if (!opt.input) opt.input = argv[i];
+            opt.inputs.push_back(argv[i]);
+        } else {
+            print_usage(argv[0]);
+            return 1;
         }
+    }
 
-        if (retval.reason) do_k23_edge_replacement = false;
-
-        if (retval.reason) {
-            retval.is_sp = false;
-            break;
+    if (opt.trace_json[0]) {
+        if (opt.input) {
+            print_usage(argv[0]);
+            return 1;
         }
+        return (trace_to_json(opt.trace_json[0], opt.trace_json[1]) ? 0 : 1);
+    }
 
-        if (cut_verts[root] != -1) {
-            #ifdef __VERBOSE_LOGGING__
-            if (cut_vertex_attached_tree[cut_verts[root]].root) {
-                V_LOG("combine tree " << cut_vertex_attached_tree[cut_verts[root]] << " with " << seq[next] << " (bicomp " << bicomp << ")\n");
-            }
-            #endif
+    // saved on the way out of main, once every traced thread is joined
+    if (opt.trace) trace_start(opt.trace_level, opt.trace_buffer);
+    trace_writer writer{opt.trace};
 
-            seq[next].compose(std::move(cut_vertex_attached_tree[cut_verts[root]]), c_type::dangling);
+    if (opt.oracle_file) {
+        if (opt.input || !opt.distance_queries) {
+            print_usage(argv[0]);
+            return 1;
         }
 
-        if (bicomp < n_bicomps - 1) {
-            V_LOG("ATTACH " << seq[next] << " to cut vertex " << root << " (bicomp " << bicomp << ")\n");
-            cut_vertex_attached_tree[cut_verts[root]] = std::move(seq[next]);
-        } else {
-            if (!retval.reason) {
-                std::shared_ptr<positive_cert_sp> sp{new positive_cert_sp{}};
-
-                sp->decomposition = std::move(seq[next]);
-                sp->is_sp = true;
-                retval.reason = sp;
-                retval.is_sp = true;
-                N_LOG("graph is SP\n")
-            }
+        std::ifstream is(opt.oracle_file, std::ios::binary);
+        sp_oracle_header header{};
+        if (!is.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+            std::cerr << "Error: could not map distance oracle " << opt.oracle_file << "\n";
+            return 1;
         }
+        return (header.index_bytes == sizeof(int64_t) ? run_oracle<int64_t>(opt) : run_oracle<int32_t>(opt));
     }
 
-    #ifdef __VERBOSE_LOGGING__
-        for (int i = 0; i < g.n; i++) {
-            V_LOG("vertex " << i << " ear: (" << ear[i].first << ", " << ear[i].second << ")\n")
-            V_LOG("vertex " << i << " parent: " << parent[i] << "\n")
-            V_LOG("vertex " << i << " dfs_no: " << dfs_no[i] << "\n")
+    if (opt.scaling) {
+        if (opt.input) {
+            print_usage(argv[0]);
+            return 1;
         }
-    #endif
-
-    return retval;
-}
-
-// ==================== MAIN FUNCTION ====================
-int main(int argc, char* argv[]) {
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <graph_input_file>\n";
-        return 1;
+        return run_scaling(opt.scaling, opt.scaling_max, opt.threads);
     }
 
-    std::ifstream infile(argv[1]);
-    if (!infile) {
-        std::cerr << "Error: could not open file " << argv[1] << "\n";
-        return 1;
+    // without an input file, the graph is piped in
+    if (!opt.input && !isatty(STDIN_FILENO)) {
+        opt.input = "/dev/stdin";
+        opt.inputs.push_back(opt.input);
     }
-
-    graph g;
-    infile >> g;
-    if (g.n <= 0) {
-        std::cerr << "Error: Graph must have at least one vertex\n";
+    if (!opt.input) {
+        print_usage(argv[0]);
         return 1;
     }
 
-    std::cout << "Read graph with " << g.n << " vertices and " << g.e << " edges\n\n";
-
-    sp_result result = SP_RECOGNITION(g);
-
-    std::cout << "=== Series-Parallel Recognition Results ===\n";
-    if (result.is_sp) {
-        std::cout << "The graph IS Series-Parallel.\n";
-        auto sp = std::dynamic_pointer_cast<positive_cert_sp>(result.reason);
-        if (sp && sp->decomposition.root) {
-            std::cout << "SP decomposition tree root: {"
-                      << sp->decomposition.source() << ","
-                      << sp->decomposition.sink() << "}\n";
-        } else {
-            std::cout << "Empty SP decomposition (trivial).\n";
-        }
-    } else {
-        std::cout << "The graph is NOT Series-Parallel.\n";
-        if (auto k4 = std::dynamic_pointer_cast<negative_cert_K4>(result.reason)) {
-            std::cout << "Reason: K4 subdivision on vertices {"
-                      << k4->a << "," << k4->b << "," << k4->c << "," << k4->d << "}\n";
-        } else if (auto k23 = std::dynamic_pointer_cast<negative_cert_K23>(result.reason)) {
-            std::cout << "Reason: K23 subdivision between vertices {" 
-                      << k23->a << "," << k23->b << "}\n";
-        } else if (auto t4 = std::dynamic_pointer_cast<negative_cert_T4>(result.reason)) {
-            std::cout << "Reason: T4 (theta-4) subdivision with cut vertices "
-                      << t4->c1 << "," << t4->c2
-                      << " and others " << t4->a << "," << t4->b << "\n";
-        } else if (auto tri = std::dynamic_pointer_cast<negative_cert_tri_comp_cut>(result.reason)) {
-            std::cout << "Reason: cut vertex " << tri->v << " splits into >=3 components\n";
-               } else if (auto tric = std::dynamic_pointer_cast<negative_cert_tri_cut_comp>(result.reason)) {
-            std::cout << "Reason: bicomp with 3 cut vertices {"
-                      << tric->c1 << "," << tric->c2 << "," << tric->c3 << "}\n";
-        } else {
-            std::cout << "Reason: unknown (unhandled cert type)\n";
+    // every graph would share the scratch file, the oracle file or an output file
+    if (opt.inputs.size() > 1) {
+        if (opt.external || opt.save_oracle || opt.sp_subgraph || opt.tree_decomposition || opt.block_cut) {
+            print_usage(argv[0]);
+            return 1;
         }
+        return run_batch(opt);
     }
 
-    std::cout << "\n=== Certificate Authentication ===\n";
-    if (!result.reason) {
-        std::cerr << "ERROR: No certificate generated\n";
+    mapped_file infile;
+    if (!infile.open(opt.input)) {
+        std::cerr << "Error: could not open file " << opt.input << "\n";
         return 1;
     }
 
-    bool auth_ok = false;
-    try { 
-        auth_ok = result.authenticate(g); 
-    } catch(...) { 
-        auth_ok = false; 
-    }
-
-    if (!auth_ok) {
-        std::cerr << "ERROR: Certificate authentication failed!\n";
+    graph_header header;
+    graph_text text;
+    std::string why;
+    if (!open_graph_text(infile.data, infile.data + infile.size, text, header, why)) {
+        std::cerr << "Error: " << why << "\n";
         return 1;
     }
-    
-    std::cout << "Certificate authenticated successfully.\n";
-    return 0;
+    N_LOG((header.wide() ? 64 : 32) << "-bit vertex indices\n")
+    return (header.wide() ? run<int64_t>(opt, text, header) : run<int32_t>(opt, text, header));
 }
-                       
@@ -0,0 +1,106 @@
+#!/bin/bash
+# runs the recognizer on every fixture here and compares with what is expected.
+#   <group>/<name>.txt[.gz|.zst]  the input graph
+#   <group>/<name>.args           optional: one run per line, its options put
+#                                 before the input; @ names a scratch directory
+#                                 kept across the runs of the fixture. words
+#                                 after -- replace the input, % standing for
+#                                 it: "-- % ../x.txt" runs a batch of two, a
+#                                 bare "--" runs with no input
+#   <group>/<name>.expected       per run: the command, its stdout and stderr,
+#                                 the files it wrote and its exit status
+# inputs under stdin/ are piped in through /dev/stdin. runs from the group's
+# directory, so query files are named relative to it. a batch must print what
+# its inputs print one by one, each under a "=== input ===" line. binary files
+# are listed by size, json traces by the names of their events, as their
+# times vary.
+# usage: run_tests.sh path/to/sp_recognition [--update]
+if [ $# -lt 1 ]; then
+    echo "usage: $0 path/to/sp_recognition [--update]" >&2
+    exit 2
+fi
+bin=$(realpath "$1")
+update=$2
+cd "$(dirname "$0")" || exit 2
+scratch=$(mktemp -d)
+trap 'rm -rf "$scratch" "$scratch".*' EXIT
+
+# lists a file the run wrote
+show() {
+    local f=$1
+    echo "--- @/$(basename "$f")"
+    if [[ $f == *.json ]]; then
+        python3 -c 'import json, sys; print("\n".join(sorted({e["name"] for e in json.load(open(sys.argv[1]))["traceEvents"]})))' "$f" 2>&1 ||
+            echo "(not valid json)"
+    elif [ "$(tr -d '\000' < "$f" | wc -c)" != "$(wc -c < "$f")" ]; then
+        echo "(binary, $(wc -c < "$f") bytes)"
+    else
+        cat "$f"
+    fi
+}
+
+run() {
+    local dir=$1 file=$2 args=$3
+    local words=(${args//@/$scratch}) opts=() inputs=("$file") i
+    for i in "${!words[@]}"; do
+        if [ "${words[i]}" = -- ]; then
+            inputs=("${words[@]:i+1}")
+            inputs=("${inputs[@]//\%/$file}")
+            break
+        fi
+        opts+=("${words[i]}")
+    done
+    # files left by earlier runs are aged, so only those this run writes show
+    find "$scratch" -type f -exec touch -d @0 {} +
+    if [ "$dir" = stdin ]; then
+        echo "\$ cat $file | sp_recognition ${args:+$args }/dev/stdin"
+        (cd "$dir" && cat "$file" | "$bin" "${opts[@]}" /dev/stdin) > "$scratch.out" 2> "$scratch.err"
+    else
+        echo "\$ sp_recognition${opts[*]:+ ${opts[*]}}${inputs[*]:+ ${inputs[*]}}"
+        (cd "$dir" && "$bin" "${opts[@]}" "${inputs[@]}") > "$scratch.out" 2> "$scratch.err"
+    fi
+    local status=$?
+    cat "$scratch.out"
+    if [ -s "$scratch.err" ]; then
+        echo "--- stderr"
+        cat "$scratch.err"
+    fi
+    for f in "$scratch"/*; do
+        [ -f "$f" ] && [ "$(stat -c %Y "$f")" != 0 ] && show "$f"
+    done
+    echo "--- exit status $status"
+    if [ ${#inputs[@]} -gt 1 ]; then
+        for i in "${inputs[@]}"; do
+            echo "=== $i ==="
+            (cd "$dir" && "$bin" "${opts[@]}" "$i")
+            echo
+        done > "$scratch.one"
+        cmp -s "$scratch.out" "$scratch.one" || echo "--- differs from the inputs run one by one"
+    fi
+    rm -f "$scratch.out" "$scratch.err" "$scratch.one"
+}
+
+total=0
+failed=0
+for input in */*.txt */*.txt.gz */*.txt.zst; do
+    [ -e "$input" ] || continue
+    dir=$(dirname "$input")
+    file=$(basename "$input")
+    name="$dir/${file%%.txt*}"
+    runs=("")
+    [ -f "$name.args" ] && mapfile -t runs < "$name.args"
+
+    rm -rf "${scratch:?}"/*
+    actual=$(for args in "${runs[@]}"; do run "$dir" "$file" "$args"; done | sed "s|$scratch|@|g")
+    total=$((total + 1))
+    if [ "$update" = --update ]; then
+        printf '%s\n' "$actual" > "$name.expected"
+    elif ! diff -u "$name.expected" <(printf '%s\n' "$actual") > "$scratch.diff"; then
+        echo "FAIL $input"
+        cat "$scratch.diff"
+        failed=$((failed + 1))
+    fi
+done
+rm -f "$scratch.diff"
+echo "$((total - failed)) of $total fixtures passed"
+[ $failed -eq 0 ]